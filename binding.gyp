@@ -10,7 +10,11 @@
         "src/noden_program.cc",
         "src/noden_buffer.cc",
         "src/noden_run.cc",
-        "src/cl_memory.cc"
+        "src/cl_memory.cc",
+        "src/cl_mem_pool.cc",
+        "src/host_copy.cc",
+        "src/cl_staging.cc",
+        "src/cl_svm_select.cc"
       ],
       "include_dirs": [ "include" ],
       "conditions": [
@@ -17,8 +17,58 @@ import { OpenCLPlatform } from "./types/Platform"
 export * from "./types/Platform"
 
 export type BufDir = 'readonly' | 'writeonly' | 'readwrite'
-export type BufSVMType = 'none' | 'coarse' | 'fine'
-export type ImageDims = { width: number, height: number, depth?: number }
+export type BufSVMType = 'none' | 'coarse' | 'fine' | 'staged'
+/** Buffer type requested on creation - 'auto' selects the measured fastest type for the device and buffer size */
+export type BufSVMTypeRequest = BufSVMType | 'auto'
+/** Image channel order - default 'RGBA' */
+export type ChannelOrder = 'R' | 'A' | 'RG' | 'RA' | 'RGB' | 'RGBA' | 'BGRA' | 'ARGB' | 'ABGR' |
+	'INTENSITY' | 'LUMINANCE' | 'Rx' | 'RGx' | 'RGBx' | 'sRGB' | 'sRGBx' | 'sRGBA' | 'sBGRA'
+/** Image channel data type - default 'FLOAT' */
+export type ChannelDataType = 'SNORM_INT8' | 'SNORM_INT16' | 'UNORM_INT8' | 'UNORM_INT16' |
+	'UNORM_SHORT_565' | 'UNORM_SHORT_555' | 'UNORM_INT_101010' |
+	'SIGNED_INT8' | 'SIGNED_INT16' | 'SIGNED_INT32' | 'UNSIGNED_INT8' | 'UNSIGNED_INT16' | 'UNSIGNED_INT32' |
+	'HALF_FLOAT' | 'FLOAT'
+/** Image dimensions in pixels. For array image types the dimension after the last image dimension is the number of layers */
+export type ImageDims = {
+	width: number, height: number, depth?: number,
+	channelOrder?: ChannelOrder, dataType?: ChannelDataType
+}
+
+/** Statistics for the native memory allocations of a context */
+export interface MemStats {
+	/** Number of buffer allocations satisfied from the pool */
+	readonly poolHits: number
+	/** Number of buffer allocations that required new OpenCL memory */
+	readonly poolMisses: number
+	/** Total bytes of released allocations currently held by the pool */
+	readonly poolRetainedBytes: number
+	/** Number of released allocations currently held by the pool */
+	readonly poolRetainedCount: number
+	/** Limit on the bytes that the pool will retain */
+	readonly poolMaxBytes: number
+	/** Total bytes of the parent allocations used for small buffers */
+	readonly slabBytes: number
+	/** Number of small buffers currently allocated from slabs */
+	readonly slabBlocksInUse: number
+	/** Total bytes of OpenCL memory currently created by the pool, in use or retained */
+	readonly allocatedBytes: number
+	/** Highest value of allocatedBytes since the context was created */
+	readonly peakAllocatedBytes: number
+	/** Limit on allocatedBytes before retained allocations are evicted */
+	readonly budgetBytes: number
+	/** Number of retained allocations and unused slabs freed to stay within the limits */
+	readonly evictions: number
+	/** Number of released allocations waiting for queued work to complete before they return to the pool */
+	readonly pendingReleases: number
+	/** Bytes of the released allocations waiting to return to the pool */
+	readonly pendingReleaseBytes: number
+	/** Number of implicit copies from a buffer to its image, made when the image cannot share the buffer memory */
+	readonly imageCopiesToImage: number
+	/** Number of implicit copies from an image back to its buffer */
+	readonly imageCopiesToBuffer: number
+	/** Total bytes moved by implicit image and buffer copies */
+	readonly imageCopyBytes: number
+}
 
 /** Internal structure for managing allocated buffers */
 export interface ContextBuffer {
@@ -48,6 +98,8 @@ interface OpenCLBufferInternals {
 	readonly numBytes: number
   /** The time taken to perform the allocation of OpenCL memory for this OpenCLBuffer */
 	readonly creationTime: number
+  /** Set for buffers from wrapBuffer - true when the OpenCL memory uses the wrapped memory, false when it is a copy */
+	readonly wrapped?: boolean
 	/** Field to carry a frame timestamp */
 	timestamp: number
 
@@ -59,20 +111,40 @@ interface OpenCLBufferInternals {
 	readonly refs: number
 }
 
+/** Timings object returned by the OpenCLBuffer hostAccess function */
+export interface HostAccessTimings {
+	/** Total time in microseconds to make the buffer available and copy any source buffer */
+	readonly totalTime: number
+	/** Number of bytes copied from the source buffer, 0 if no source buffer was provided */
+	readonly copyBytes: number
+	/** Time in microseconds for the copy from the source buffer */
+	readonly copyTime: number
+	/** Achieved copy rate in GB/s */
+	readonly copyGBps: number
+}
+
+/** Timings object returned by the clContext copyBuffer functions */
+export interface CopyTimings {
+	/** Time in microseconds to enqueue the copy, and to complete it when overlapping is not enabled */
+	readonly totalTime: number
+	/** Number of bytes copied */
+	readonly copyBytes: number
+}
+
 /** Functions that operate on OpenCLBuffer objects */
 interface OpenCLBufferFunctions {
 	/** Allow normal [host access](https://github.com/Streampunk/nodencl#host-access-to-data-buffers) to the buffer for read and write operations in Javascript.
 	 * @param bufDir the host data direction for which the access is required, will default to `readwrite`.
-	 * @returns a promise that resolves when host access is available.
+	 * @returns a promise that resolves to a HostAccessTimings object when host access is available.
 	 */
-	hostAccess(bufDir?: BufDir): Promise<undefined>
+	hostAccess(bufDir?: BufDir): Promise<HostAccessTimings>
 	/** Allow normal [host access](https://github.com/Streampunk/nodencl#host-access-to-data-buffers) to the buffer for read and write operations in Javascript.
 	 * @param bufDir the host data direction for which the access is required.
 	 * @param sourceBuf Allows a source buffer to be passed to the asynchronous thread and be
 	 * copied into the buffer object. Requires that the bufDir is not `readonly`.
-	 * @returns a promise that resolves when any source copy is complete and host access is available.
+	 * @returns a promise that resolves to a HostAccessTimings object when any source copy is complete and host access is available.
 	 */
-	hostAccess(bufDir: BufDir | 'none', sourceBuf: Buffer): Promise<undefined>
+	hostAccess(bufDir: BufDir | 'none', sourceBuf: Buffer): Promise<HostAccessTimings>
 	/**
 	 * Allow normal [host access](https://github.com/Streampunk/nodencl#host-access-to-data-buffers) to the buffer for read and write operations in Javascript,
 	 * with [overlapping](https://github.com/Streampunk/nodencl#overlapping) support.
@@ -80,17 +152,48 @@ interface OpenCLBufferFunctions {
 	 * @param queueNum the CommandQueue to use for this operation when overlapping is enabled.
 	 * Typically will be `context.queue.load` or `context.queue.unload`.
 	 * @param sourceBuf an optional Buffer object to be used as source data when the bufDir is not readonly
-	 * @returns a promise that resolves when any source copy is complete and host access is available.
+	 * @returns a promise that resolves to a HostAccessTimings object when any source copy is complete and host access is available.
+	 */
+	hostAccess(bufDir: BufDir | 'none', queueNum: number, sourceBuf?: Buffer): Promise<HostAccessTimings>
+	/**
+	 * Allow [host access](https://github.com/Streampunk/nodencl#host-access-to-data-buffers) to part of the buffer, mapping only that region.
+	 * @param bufDir the host data direction for which the access is required.
+	 * @param queueNum the CommandQueue to use for this operation when overlapping is enabled.
+	 * @param region the byte offset and length of the region, defaulting to the rest of the buffer
+	 * @returns a promise that resolves to a Buffer view of the region when host access is available.
+	 * Other parts of the buffer must not be accessed until the next hostAccess call.
+	 */
+	hostAccess(bufDir: BufDir, region: { offset?: number, length?: number }): Promise<Buffer>
+	hostAccess(bufDir: BufDir, queueNum: number, region: { offset?: number, length?: number }): Promise<Buffer>
+	/**
+	 * Fill the buffer on the device without host access, for example to clear an output frame.
+	 * Without an options object this is the normal synchronous Buffer fill of host memory.
+	 * @param pattern A byte value, or a Buffer or typed array pattern whose size is a power of two up to 128 bytes,
+	 * or for a buffer with image dimensions an array of up to four colour components that fills the whole image
+	 * @param options The byte offset and size of the region to fill - defaulting to the rest of the buffer - and the CommandQueue to use
+	 * @returns a promise that resolves to an object with the totalTime in microseconds when the fill is complete,
+	 * or when overlapping is enabled once the fill has been enqueued
+	 */
+	fill(pattern: number | Buffer | ArrayBufferView | number[],
+		options: { offset?: number, size?: number, queueNum?: number }): Promise<{ totalTime: number }>
+	/**
+	 * Move the buffer memory to the device ahead of a kernel run, or back to the host ahead of host access,
+	 * for example to load the next frame on `context.queue.load` while `context.queue.process` is busy.
+	 * Host access is released by migration to the device. Has no effect for fine-grained SVM buffers when `context.unifiedMemory` is set.
+	 * @param dir where the memory is required next
+	 * @param queueNum the CommandQueue to use, defaulting to 0
+	 * @returns a promise that resolves to an object with the totalTime in microseconds when the migration is complete,
+	 * or when overlapping is enabled once the migration has been enqueued
 	 */
-	hostAccess(bufDir: BufDir | 'none', queueNum: number, sourceBuf?: Buffer): Promise<undefined>
+	migrate(dir: 'device' | 'host', queueNum?: number): Promise<{ totalTime: number }>
 	/** Free any allocated OpenCL memory associated with this OpenCLBuffer object */
 	freeAllocation(): undefined
 
-	/** Increment the reference count of this OpenCLBuffer object to keep it in the buffer cache */
+	/** Increment the reference count of this OpenCLBuffer object to keep its allocation out of the pool */
 	addRef() : void
 	/**
 	 * Decrement the reference count of this OpenCLBuffer object.
-	 * If the reference count becomes zero allow the allocation to be re-used
+	 * If the reference count becomes zero the allocation is returned to the pool to be re-used
 	 */
 	release() : void
 }
@@ -99,7 +202,9 @@ export type OpenCLBuffer = Buffer & OpenCLBufferFunctions & OpenCLBufferInternal
 
 /**
  * Parameters for the Program run function. Parameter names must match the parameter names of the chosen
- * kernel program
+ * kernel program. Scalar arguments take a number, or a BigInt for long and ulong. Vector arguments take an
+ * array or typed array with one value per component, or a number to set every component. Local memory
+ * arguments take a size in bytes, or a function of the work-group size returning one.
  */
 export interface KernelParams {
 	[key: string]: unknown
@@ -115,12 +220,32 @@ export interface RunTimings {
 	readonly dataToKernel: number
 	/** Time taken in processing the kernel */
 	readonly kernelExec: number
-	/** Time taken in transferring data from GPU memory to host memory - only used during development */
+	/** Time taken in making readback outputs available to the host, including waiting for the kernel to complete */
 	readonly dataFromKernel: number
   /** Total time taken during transfers and processing */
 	readonly totalTime: number
 }
 
+/** Kernel parameters resolved once by program.bind, for repeated runs with little per-run overhead */
+export interface BoundParams {
+	/**
+	 * Replace the value of one parameter, such as a scalar that changes for each frame or a different buffer
+	 * @param name the kernel parameter name
+	 * @param value the new value, of a type that matches the kernel parameter
+	 * @returns the bound parameters object
+	 */
+	set(name: string, value: unknown): BoundParams
+}
+
+export interface RunOptions {
+	/**
+	 * Names of buffer parameters to be mapped for readonly host access behind the kernel on the same queue,
+	 * avoiding a separate `hostAccess('readonly')` call. The run then resolves when the outputs are host readable,
+	 * or when overlapping is enabled once the maps have been enqueued.
+	 */
+	readback?: string[]
+}
+
 export interface OpenCLProgram {
 	/** The OpenCL kernel is held as a Javascript string */
 	readonly kernelSource: string
@@ -136,7 +261,15 @@ export interface OpenCLProgram {
 	 * @param queueNum the CommandQueue to be used to run the program. Typically will be `context.queue.process`
 	 * @returns Promise that resolves to a RunTimings object on success
 	 */
-	run(params: KernelParams, queueNum?: number): Promise<RunTimings>
+	run(params: KernelParams | BoundParams, queueNum?: number, options?: RunOptions): Promise<RunTimings>
+	run(params: KernelParams | BoundParams, options: RunOptions): Promise<RunTimings>
+	/**
+	 * Resolve the kernel parameters once, so that each run of the returned object only copies the prepared values
+	 * @param params an object with keys that match the selected kernel parameter names and
+	 * data types that match the selected kernel parameters
+	 * @returns BoundParams object to pass to run in place of a parameters object
+	 */
+	bind(params: KernelParams): BoundParams
 }
 
 /** Object to hold a context for a selected OpenCL platform and device */
@@ -159,17 +292,37 @@ export class clContext {
 			deviceIndex: number
 			/** Enable [overlapping](https://github.com/Streampunk/nodencl#overlapping) of data transfers and running kernels */
 			overlapping?: boolean
+			/** Limit on the bytes of released allocations retained for reuse. Defaults to a quarter of the device global memory */
+			poolMaxBytes?: number
+			/** Buffers up to this size without image dimensions are sub-allocated from shared slabs. Defaults to 16384, 0 disables */
+			slabMaxBytes?: number
+			/** Budget for the OpenCL memory created by the context. Defaults to the device global memory */
+			memBudgetBytes?: number
+			/** Keep fine-grained SVM buffers mapped, and map whole buffers of SVM type none, when the device shares memory with the host. Defaults to true, only takes effect when the device reports unified memory */
+			unifiedMemory?: boolean
+			/** Number of threads, including the calling thread, used for hostAccess source copies. Defaults to half the CPU cores, at most 4 */
+			copyThreads?: number
+			/** Source copies of at least this size are split between the copy threads. Defaults to 1048576 */
+			copyMinBytes?: number
+			/** Size of the pieces that a parallel source copy is split into. Defaults to 262144 */
+			copyChunkBytes?: number
+			/** Number of pinned host buffers in the ring used by 'staged' buffers. Defaults to 4 */
+			stagingSlots?: number
+			/** Size of each pinned staging buffer, the unit of a staged transfer. Defaults to 1048576 */
+			stagingChunkBytes?: number
 		},
 		logger?: { log?: Function, warn?: Function, error?: Function }
 	)
 
 	// Internal parameters
-	readonly params: { platformIndex: number, deviceIndex: number, overlapping: boolean }
+	readonly params: { platformIndex: number, deviceIndex: number, overlapping: boolean, poolMaxBytes?: number, slabMaxBytes?: number, memBudgetBytes?: number,
+		unifiedMemory?: boolean, copyThreads?: number, copyMinBytes?: number, copyChunkBytes?: number,
+		stagingSlots?: number, stagingChunkBytes?: number }
 	readonly logger: { log: Function, warn: Function, error: Function }
-	readonly buffers: ReadonlyArray<ContextBuffer>
+	readonly buffers: ReadonlyMap<number, ContextBuffer>
 	readonly bufIndex: number
 	readonly queue: { load: number, process: number, unload: number }
-	readonly context: {	svmCaps: number, platformIndex: number, deviceIndex: number, numQueues: number }
+	readonly context: {	svmCaps: number, platformIndex: number, deviceIndex: number, numQueues: number, unifiedMemory: boolean }
 
 	/**
 	 * Initialise the context object on the hardware
@@ -203,7 +356,8 @@ export class clContext {
 
   /**
 	 * Create an OpenCL [buffer](https://github.com/Streampunk/nodencl#creating-data-buffers) for use by OpenCL programs
-	 * @param numBytes The size of the desired buffer in bytes
+	 * @param numBytes The size of the desired buffer in bytes, up to the device maxMemAllocSize
+	 * and the Node.js maximum Buffer length
 	 * @param bufDir The data direction for the buffer with respect to execution of kernel functions
 	 * @param bufType The type of Shared Virtual Memory to be used for the buffer
 	 * @param imageDims The image dimensions to be used if this buffer is to be used as a kernel image type parameter
@@ -213,14 +367,34 @@ export class clContext {
 	createBuffer(
 		numBytes: number,
 		bufDir: BufDir,
-		bufType: BufSVMType,
+		bufType: BufSVMTypeRequest,
 		imageDims?: ImageDims,
 		owner?: string
 	): Promise<OpenCLBuffer>
 
+	/**
+	 * [Wrap](https://github.com/Streampunk/nodencl#wrapping-existing-buffers) the memory of an existing Buffer or ArrayBuffer as an OpenCLBuffer without a copy
+	 * @param srcBuf The memory to use. It is held until the OpenCLBuffer is released.
+	 * @param bufDir The data direction for the buffer with respect to execution of kernel functions
+	 * @param owner Name that can be helpful in logging and enables resource management via a cache
+	 * @returns Promise that resolves to an OpenCLBuffer object over the same memory, or a copy of it if the memory
+	 * does not meet the device alignment requirements
+	 */
+	wrapBuffer(
+		srcBuf: Buffer | ArrayBuffer,
+		bufDir: BufDir,
+		owner?: string
+	): Promise<OpenCLBuffer>
+
   /** Log any buffer allocations that have had the owner parameter set */
 	logBuffers(): null
 
+	/**
+	 * Get statistics for the native memory allocations of this context
+	 * @returns MemStats object with the pool hit and miss counters and retained memory
+	 */
+	getMemStats(): MemStats
+
   /**
 	 * Release any buffer allocations that have had the selected owner parameter set
 	 * @param owner String matching the owner name set during buffer creation
@@ -244,6 +418,63 @@ export class clContext {
 		queueNum?: number
 	): Promise<RunTimings>
 
+	/**
+	 * Run many programs in one asynchronous operation, enqueuing their kernels back to back and waiting once.
+	 * When overlapping is enabled the promise resolves once the kernels are enqueued.
+	 * @param runs The program and its parameters, or parameters bound with program.bind, for each kernel in order
+	 * @param queueNum The CommandQueue to use when overlapping is enabled, defaulting to 0
+	 * @returns Promise that resolves to an array of RunTimings objects, one for each run
+	 */
+	runMany(
+		runs: { program: OpenCLProgram, params: KernelParams | BoundParams }[],
+		queueNum?: number
+	): Promise<RunTimings[]>
+
+	/**
+	 * Set [host access](https://github.com/Streampunk/nodencl#host-access-to-data-buffers) for many buffers in one
+	 * asynchronous operation, waiting once for all the maps and then copying any source buffers.
+	 * @param requests The buffer, the host data direction and an optional source buffer for each buffer
+	 * @param queueNum The CommandQueue to use when overlapping is enabled, defaulting to 0
+	 * @returns Promise that resolves to a HostAccessTimings object totalled over all the buffers
+	 */
+	hostAccessMany(
+		requests: { buf: OpenCLBuffer, dir: BufDir | 'none', src?: Buffer }[],
+		queueNum?: number
+	): Promise<HostAccessTimings>
+
+	/**
+	 * Copy between two OpenCLBuffers on the device, without mapping either buffer to the host.
+	 * When overlapping is enabled the promise resolves once the copy is enqueued.
+	 * @param srcBuf The buffer to copy from
+	 * @param dstBuf The buffer to copy to
+	 * @param options Byte offsets into each buffer, the number of bytes to copy - defaulting to as many as
+	 * will fit - and the CommandQueue to use
+	 * @returns Promise that resolves to a CopyTimings object
+	 */
+	copyBuffer(
+		srcBuf: OpenCLBuffer,
+		dstBuf: OpenCLBuffer,
+		options?: { srcOffset?: number, dstOffset?: number, bytes?: number, queueNum?: number }
+	): Promise<CopyTimings>
+	/**
+	 * Copy a 2D or 3D rectangular region between two OpenCLBuffers on the device, for example to crop a picture
+	 * or extract a tile. Origins and region are given as [ bytes, rows, slices ] as for clEnqueueCopyBufferRect.
+	 * Pitches are in bytes, a pitch of 0 taking the OpenCL default computed from the region.
+	 * @param srcBuf The buffer to copy from
+	 * @param dstBuf The buffer to copy to
+	 * @param options The region to copy, the origins and pitches of each buffer and the CommandQueue to use
+	 * @returns Promise that resolves to a CopyTimings object
+	 */
+	copyBufferRect(
+		srcBuf: OpenCLBuffer,
+		dstBuf: OpenCLBuffer,
+		options: {
+			region: number[], srcOrigin?: number[], dstOrigin?: number[],
+			srcRowPitch?: number, srcSlicePitch?: number, dstRowPitch?: number, dstSlicePitch?: number,
+			queueNum?: number
+		}
+	): Promise<CopyTimings>
+
 	/**
 	 * Wait for the selected queue to complete - only required when overlapping is enabled
 	 * @param queueNum The CommandQueue to wait for
@@ -14,6 +14,7 @@
 */
 
 const addon = require('bindings')('nodencl');
+const bufferConstants = require('buffer').constants;
 
 const SegfaultHandler = require('segfault-handler');
 SegfaultHandler.registerHandler('crash.log'); // With no argument, SegfaultHandler will generate a generic log file name
@@ -27,32 +28,61 @@ async function createContext(params) {
     await addon.createContext({
       platformIndex: params.platformIndex, 
       deviceIndex: params.deviceIndex,
-      numQueues: params.overlapping ? 3 : 1
+      numQueues: params.overlapping ? 3 : 1,
+      poolMaxBytes: params.poolMaxBytes,
+      slabMaxBytes: params.slabMaxBytes,
+      memBudgetBytes: params.memBudgetBytes,
+      unifiedMemory: params.unifiedMemory,
+      copyThreads: params.copyThreads,
+      copyMinBytes: params.copyMinBytes,
+      copyChunkBytes: params.copyChunkBytes,
+      stagingSlots: params.stagingSlots,
+      stagingChunkBytes: params.stagingChunkBytes
     });
 }
 
 function addReference(buffer, buffers) {
   // console.log(`addRef ${buffer.index}: ${buffer.owner} ${buffer.length} bytes - refs ${buffer.refs}, ${buffer.reserved?'reserved':'free'}`);
-  if (!buffers.find(el => el.index === buffer.index))
+  if (!buffers.has(buffer.index))
     console.error(`addReference on freed buffer ${buffer.index}: ${buffer.owner} ${buffer.length} bytes`);
   if (!buffer.reserved)
     console.warn(`addReference on unreserved buffer ${buffer.index}: ${buffer.owner} ${buffer.length} bytes`);
   buffer.refs++;
 }
 
-function releaseReference(buffer) {
+function releaseReference(buffer, buffers) {
   // console.log(`release ${buffer.index}: ${buffer.owner} ${buffer.length} bytes - refs ${buffer.refs}, ${buffer.reserved?'reserved':'free'}`);
   if (!buffer.reserved)
     console.warn(`releaseReference on unreserved buffer ${buffer.index}: ${buffer.owner} ${buffer.length} bytes`);
   if (buffer.refs > 0) buffer.refs--;
-  if (0 === buffer.refs)
+  if (0 === buffer.refs) {
+    // hand the OpenCL allocation back to the native pool for reuse
     buffer.reserved = false;
+    buffer.freeAllocation();
+    buffers.delete(buffer.index);
+  }
+}
+
+// The OpenCL allocation of a released buffer may already be in use by another buffer or freed
+function checkReserved(buffer, use) {
+  if (buffer && (false === buffer.reserved))
+    throw new Error(`${use} of released buffer ${buffer.index}: ${buffer.owner} ${buffer.length} bytes`);
+}
+
+function guardReleased(buffer) {
+  [ 'hostAccess', 'fill', 'migrate' ].forEach(name => {
+    const method = buffer[name];
+    buffer[name] = function(...args) {
+      checkReserved(buffer, name);
+      return method.apply(buffer, args);
+    };
+  });
 }
 
 function clContext(params, logger) {
   this.params = params;
   this.logger = logger || { log: console.log, warn: console.warn, error: console.error };
-  this.buffers = [];
+  this.buffers = new Map();
   this.bufIndex = 0;
   this.queue = { load: 0, process: params.overlapping ? 1 : 0, unload: params.overlapping ? 2 : 0 };
   this.context = undefined;
@@ -60,6 +90,11 @@ function clContext(params, logger) {
   this.logBuffers = () => this.buffers.forEach(el => 
     this.logger.log(`${el.index}: ${el.owner} ${el.length} bytes ${el.reserved?'reserved':'available'}`));
 
+  this.getMemStats = () => {
+    this.checkContext();
+    return this.context.getMemStats();
+  };
+
   this.checkContext = () => {
     if (undefined === this.context) throw new Error('clContext must be initialised');
   };
@@ -79,12 +114,11 @@ clContext.prototype.checkAlloc = async function(cb) {
   try {
     result = await cb();
   } catch (err) {
+    // The native pool evicts retained allocations to keep within the memory budget before allocating,
+    // so this is a last resort for when the device runs out of memory below the budget
     if (-4 == err.code) { // memory allocation failure
-      this.logger.warn('Failed to allocate OpenCL memory - freeing unreserved allocations');
-      this.buffers = this.buffers.filter(el => {
-        if (!el.reserved) el.freeAllocation();
-        return el.reserved === true;
-      });
+      this.logger.warn('Failed to allocate OpenCL memory - freeing allocations retained by the pool');
+      await this.context.trimPool();
       result = await cb();
     } else
       throw err;
@@ -93,19 +127,11 @@ clContext.prototype.checkAlloc = async function(cb) {
 };
 
 clContext.prototype.createBuffer = async function(numBytes, bufDir, bufType, imageDims, owner) {
+  if (numBytes > bufferConstants.MAX_LENGTH)
+    throw new RangeError(`Buffer size ${numBytes} is larger than the maximum Buffer length ${bufferConstants.MAX_LENGTH}`);
   if (!bufType) bufType = 'none';
   if (!imageDims) imageDims = {};
-  const buf = this.buffers.find(el => 
-    !el.reserved && (el.length === numBytes) && (el.bufDir === bufDir) &&
-                    (el.bufType === bufType));
-  if (buf) {
-    // this.logger.log(`reuse ${buf.index}: ${owner} <- ${buf.owner} ${numBytes} bytes`);
-    buf.reserved = true;
-    buf.owner = owner;
-    buf.timestamp = 0;
-    buf.refs = 1;
-    return buf;
-  } else return this.checkAlloc(() => {
+  return this.checkAlloc(() => {
     this.checkContext();
     // this.logger.log(`new ${this.bufIndex}: ${owner} ${numBytes} bytes`);
     const bufIndex = this.bufIndex;
@@ -116,22 +142,48 @@ clContext.prototype.createBuffer = async function(numBytes, bufDir, bufType, ima
         buf.owner = owner;
         buf.index = bufIndex;
         buf.bufDir = bufDir;
-        buf.bufType = bufType;
         buf.imageDims = imageDims;
         buf.timestamp = 0;
         buf.refs = 1;
         buf.addRef = () => addReference(buf, this.buffers);
-        buf.release = () => releaseReference(buf);
-        if (owner) this.buffers.push(buf);
+        buf.release = () => releaseReference(buf, this.buffers);
+        guardReleased(buf);
+        if (owner) this.buffers.set(bufIndex, buf);
+        return buf;
+      });
+  });
+};
+
+clContext.prototype.wrapBuffer = async function(srcBuf, bufDir, owner) {
+  return this.checkAlloc(() => {
+    this.checkContext();
+    const bufIndex = this.bufIndex;
+    this.bufIndex++;
+    return this.context.wrapBuffer(srcBuf, bufDir)
+      .then(buf => {
+        buf.reserved = true;
+        buf.owner = owner;
+        buf.index = bufIndex;
+        buf.bufDir = bufDir;
+        buf.imageDims = {};
+        buf.timestamp = 0;
+        buf.refs = 1;
+        buf.addRef = () => addReference(buf, this.buffers);
+        buf.release = () => releaseReference(buf, this.buffers);
+        guardReleased(buf);
+        if (owner) this.buffers.set(bufIndex, buf);
         return buf;
       });
   });
 };
 
 clContext.prototype.releaseBuffers = function(owner) {
-  this.buffers = this.buffers.filter(el => {
-    if (el.owner === owner) el.freeAllocation();
-    return el.owner !== owner; 
+  this.buffers.forEach(el => {
+    if (el.owner === owner) {
+      el.reserved = false;
+      el.freeAllocation();
+      this.buffers.delete(el.index);
+    }
   });
 };
 
@@ -141,9 +193,36 @@ clContext.prototype.createProgram = async function(kernel, options) {
 };
 
 clContext.prototype.runProgram = async function(program, params, owner) {
+  Object.keys(params).forEach(k => checkReserved(params[k], 'run'));
   return await this.checkAlloc(() => program.run(params, owner));
 };
 
+clContext.prototype.runMany = async function(runs, queueNum) {
+  this.checkContext();
+  runs.forEach(r => Object.keys(r.params || {}).forEach(k => checkReserved(r.params[k], 'runMany')));
+  return await this.checkAlloc(() => this.context.runMany(runs, queueNum || 0));
+};
+
+clContext.prototype.hostAccessMany = async function(requests, queueNum) {
+  this.checkContext();
+  requests.forEach(r => checkReserved(r.buf, 'hostAccessMany'));
+  return this.context.hostAccessMany(requests, queueNum || 0);
+};
+
+clContext.prototype.copyBuffer = async function(srcBuf, dstBuf, options) {
+  this.checkContext();
+  checkReserved(srcBuf, 'copyBuffer');
+  checkReserved(dstBuf, 'copyBuffer');
+  return this.context.copyBuffer(srcBuf, dstBuf, options || {});
+};
+
+clContext.prototype.copyBufferRect = async function(srcBuf, dstBuf, options) {
+  this.checkContext();
+  checkReserved(srcBuf, 'copyBufferRect');
+  checkReserved(dstBuf, 'copyBufferRect');
+  return this.context.copyBufferRect(srcBuf, dstBuf, options || {});
+};
+
 clContext.prototype.waitFinish = async function(queueNum) {
   this.checkContext();
   return this.context.waitFinish(queueNum);
@@ -152,25 +231,29 @@ clContext.prototype.waitFinish = async function(queueNum) {
 clContext.prototype.close = async function(done) {
   return new Promise((resolve) => {
     const i = setInterval(() => {
-      if (0 === this.buffers.length) {
+      if (0 === this.buffers.size) {
         this.logger.log('All OpenCL allocations have been released');
         clearInterval(this.bufLog);
         clearInterval(i);
         clearInterval(t);
-        this.context = null;
-        if (done) done();
-        resolve();
+        this.context.trimPool().then(() => {
+          this.context = null;
+          if (done) done();
+          resolve();
+        });
       }
     }, 20);
     const t = setTimeout(() => {
       clearInterval(this.bufLog);
       clearInterval(i);
       this.logger.warn('Timed out waiting for release of OpenCL allocations');
-      this.buffers = this.buffers.map(el => el.freeAllocation());
-      this.buffers.length = 0;
-      this.context = null;
-      if (done) done();
-      resolve();
+      this.buffers.forEach(el => el.freeAllocation());
+      this.buffers.clear();
+      this.context.trimPool().then(() => {
+        this.context = null;
+        if (done) done();
+        resolve();
+      });
     }, 1000);
   });
 };
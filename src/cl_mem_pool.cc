@@ -0,0 +1,543 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "cl_mem_pool.h"
+#include "noden_util.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct allocKeyHash {
+  size_t operator()(const allocKey& k) const {
+    size_t h = std::hash<size_t>()(k.sizeClass);
+    h ^= ((size_t)k.memFlags << 8) ^ ((size_t)k.svmType << 12);
+    return h;
+  }
+};
+
+// Allocation waiting on the reclaimer thread for queued work that may use it to complete
+struct pendingRelease {
+  clAllocation *alloc;
+  std::vector<cl_event> fences;
+  // set instead of alloc for a buffer that is not from the pool
+  cl_mem externalMem;
+  void (*released)(void *);
+  void *releasedData;
+
+  size_t numBytes() const { return alloc ? alloc->key.sizeClass : 0; }
+};
+
+// Parent allocation shared between the blocks of one size
+struct clSlab {
+  cl_mem parentMem = nullptr;
+  void *parentHostBuf = nullptr;
+  size_t numBytes = 0;
+  uint32_t blocksInUse = 0;
+  std::vector<clAllocation> blocks;
+};
+
+// Round up to a quarter power of two so that recycled allocations waste at most 25%
+size_t allocSizeClass(size_t numBytes) {
+  const size_t minClass = 256;
+  if (numBytes <= minClass)
+    return minClass;
+  size_t top = minClass;
+  while (top < numBytes)
+    top <<= 1;
+  size_t step = top / 8;
+  return (numBytes + step - 1) / step * step;
+}
+
+// Slab blocks are powers of two no smaller than the device base address alignment
+size_t slabBlockSize(size_t numBytes, size_t baseAddrAlign) {
+  size_t blockSize = baseAddrAlign;
+  while (blockSize < numBytes)
+    blockSize <<= 1;
+  return blockSize;
+}
+
+class clMemPool : public iClMemPool {
+public:
+  clMemPool(cl_context context, uint64_t maxRetainedBytes, uint64_t slabMaxBytes, uint32_t baseAddrAlign,
+            uint64_t maxAllocBytes, uint64_t budgetBytes)
+    : mContext(context), mBaseAddrAlign(baseAddrAlign > 0 ? baseAddrAlign : 128), mMaxAllocBytes(maxAllocBytes),
+      mReclaimQuit(false), mReclaimBusy(false) {
+    mStats.maxRetainedBytes = maxRetainedBytes;
+    mStats.slabMaxBytes = slabMaxBytes;
+    mStats.budgetBytes = budgetBytes;
+    clRetainContext(mContext);
+    mReclaimer = std::thread(&clMemPool::reclaimLoop, this);
+  }
+  ~clMemPool() {
+    {
+      std::lock_guard<std::mutex> lk(mReclaimMutex);
+      mReclaimQuit = true;
+    }
+    mReclaimCv.notify_all();
+    mReclaimer.join();
+    trim();
+    for (auto slab: mSlabs)
+      destroySlab(slab);
+    clReleaseContext(mContext);
+  }
+
+  clAllocation *acquire(eMemFlags memFlags, eSvmType svmType, size_t numBytes, bool forImage) {
+    if ((numBytes <= mStats.slabMaxBytes) && !forImage)
+      return acquireBlock(memFlags, svmType, numBytes);
+
+    allocKey key = { allocSizeClass(numBytes), memFlags, svmType };
+    if (mMaxAllocBytes && (key.sizeClass > mMaxAllocBytes))
+      key.sizeClass = numBytes; // rounding up would exceed the device limit
+    // a matching allocation that is still being released is usually only waiting for a marker
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto freeIter = mFreeLists.find(key);
+        if ((freeIter != mFreeLists.end()) && !freeIter->second.empty()) {
+          clAllocation *alloc = freeIter->second.back();
+          freeIter->second.pop_back();
+          mLru.erase(alloc->lruIter);
+          mStats.hits++;
+          mStats.retainedBytes -= key.sizeClass;
+          mStats.retainedCount--;
+          return alloc;
+        }
+      }
+      if ((attempt > 0) || !isPending(key, false))
+        break;
+      waitPending();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStats.misses++;
+    }
+
+    makeRoom(key.sizeClass);
+    clAllocation *alloc = new clAllocation;
+    alloc->key = key;
+    if (!createAllocation(alloc)) {
+      delete alloc;
+      return nullptr;
+    }
+    return alloc;
+  }
+
+  void release(clAllocation *alloc, const std::vector<cl_event>& fences) {
+    {
+      std::lock_guard<std::mutex> lk(mReclaimMutex);
+      mPending.push_back({ alloc, fences, nullptr, nullptr, nullptr });
+      mPendingBytes += alloc->key.sizeClass;
+    }
+    mReclaimCv.notify_one();
+  }
+
+  void releaseExternal(cl_mem mem, const std::vector<cl_event>& fences, void (*released)(void *), void *releasedData) {
+    {
+      std::lock_guard<std::mutex> lk(mReclaimMutex);
+      mPending.push_back({ nullptr, fences, mem, released, releasedData });
+    }
+    mReclaimCv.notify_one();
+  }
+
+  uint64_t trim() {
+    waitPending();
+    return trimRetained();
+  }
+
+  // Holding the reclaim lock means an allocation that is being released is counted as pending, retained or both
+  poolStats stats() const {
+    std::lock_guard<std::mutex> lk(mReclaimMutex);
+    std::lock_guard<std::mutex> lock(mMutex);
+    poolStats stats = mStats;
+    stats.pendingReleases = mPending.size() + (mReclaimBusy ? 1 : 0);
+    stats.pendingReleaseBytes = mPendingBytes;
+    return stats;
+  }
+
+private:
+  cl_context mContext;
+  const size_t mBaseAddrAlign;
+  const uint64_t mMaxAllocBytes;
+  mutable std::mutex mMutex;
+  std::unordered_map<allocKey, std::vector<clAllocation *>, allocKeyHash> mFreeLists;
+  std::unordered_map<allocKey, std::vector<clAllocation *>, allocKeyHash> mBlockFreeLists;
+  std::vector<clSlab *> mSlabs;
+  std::list<clAllocation *> mLru;
+  poolStats mStats;
+
+  // Releases are completed on a reclaimer thread so that waiting for the fences and any driver calls
+  // to free memory do not block the Javascript thread
+  mutable std::mutex mReclaimMutex;
+  std::condition_variable mReclaimCv;
+  std::condition_variable mReclaimDoneCv;
+  std::deque<pendingRelease> mPending;
+  uint64_t mPendingBytes = 0;
+  bool mReclaimQuit;
+  bool mReclaimBusy;
+  std::thread mReclaimer;
+
+  void reclaimLoop() {
+    std::unique_lock<std::mutex> lk(mReclaimMutex);
+    while (true) {
+      mReclaimCv.wait(lk, [this] { return mReclaimQuit || !mPending.empty(); });
+      if (mPending.empty())
+        break; // quitting once all pending releases are complete
+
+      pendingRelease pending = mPending.front();
+      mPending.pop_front();
+      mReclaimBusy = true;
+      lk.unlock();
+
+      if (!pending.fences.empty()) {
+        cl_int error = clWaitForEvents((cl_uint)pending.fences.size(), pending.fences.data());
+        if (CL_SUCCESS != error)
+          printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+            __FILE__, __LINE__, error, clGetErrorString(error));
+        for (auto fence: pending.fences)
+          clReleaseEvent(fence);
+      }
+      if (pending.alloc)
+        releaseNow(pending.alloc);
+      else {
+        clReleaseMemObject(pending.externalMem);
+        if (pending.released)
+          pending.released(pending.releasedData);
+      }
+
+      lk.lock();
+      mPendingBytes -= pending.numBytes();
+      mReclaimBusy = false;
+      mReclaimDoneCv.notify_all();
+    }
+  }
+
+  // Waits for all releases queued so far to be completed by the reclaimer thread
+  void waitPending() {
+    std::unique_lock<std::mutex> lk(mReclaimMutex);
+    mReclaimDoneCv.wait(lk, [this] { return mPending.empty() && !mReclaimBusy; });
+  }
+
+  bool isPending(const allocKey& key, bool slabBlock) const {
+    std::lock_guard<std::mutex> lk(mReclaimMutex);
+    if (mReclaimBusy)
+      return true; // the allocation being released is no longer in the queue
+    for (auto& pending: mPending)
+      if (pending.alloc && (pending.alloc->key == key) && ((nullptr != pending.alloc->slab) == slabBlock))
+        return true;
+    return false;
+  }
+
+  void releaseNow(clAllocation *alloc) {
+    std::vector<clAllocation *> toFree;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (alloc->slab) {
+        mBlockFreeLists[alloc->key].push_back(alloc);
+        alloc->slab->blocksInUse--;
+        mStats.slabBlocksInUse--;
+        return;
+      }
+      if (alloc->key.sizeClass <= mStats.maxRetainedBytes) {
+        // keep the most recently used allocations when over the retained bytes limit
+        while (mStats.retainedBytes + alloc->key.sizeClass > mStats.maxRetainedBytes)
+          toFree.push_back(evictOldest());
+        mFreeLists[alloc->key].push_back(alloc);
+        alloc->lruIter = mLru.insert(mLru.end(), alloc);
+        mStats.retainedBytes += alloc->key.sizeClass;
+        mStats.retainedCount++;
+      } else
+        toFree.push_back(alloc);
+    }
+    for (auto freeAlloc: toFree)
+      destroyAllocation(freeAlloc);
+  }
+
+  uint64_t trimRetained() {
+    std::vector<clAllocation *> toFree;
+    std::vector<clSlab *> slabsToFree;
+    uint64_t freedBytes = 0;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (auto& freeIter: mFreeLists) {
+        toFree.insert(toFree.end(), freeIter.second.begin(), freeIter.second.end());
+        freeIter.second.clear();
+      }
+      mLru.clear();
+      freedBytes = mStats.retainedBytes;
+      mStats.retainedBytes = 0;
+      mStats.retainedCount = 0;
+
+      for (auto slabIter = mSlabs.begin(); slabIter != mSlabs.end(); ) {
+        clSlab *slab = *slabIter;
+        if (0 == slab->blocksInUse) {
+          removeSlabBlocks(slab);
+          freedBytes += slab->numBytes;
+          mStats.slabBytes -= slab->numBytes;
+          slabsToFree.push_back(slab);
+          slabIter = mSlabs.erase(slabIter);
+        } else
+          ++slabIter;
+      }
+    }
+    for (auto alloc: toFree)
+      destroyAllocation(alloc);
+    for (auto slab: slabsToFree)
+      destroySlab(slab);
+    return freedBytes;
+  }
+
+  // Removes the least recently used retained allocation from the pool, to be destroyed outside the lock
+  clAllocation *evictOldest() {
+    clAllocation *alloc = mLru.front();
+    mLru.pop_front();
+    auto& freeList = mFreeLists[alloc->key];
+    freeList.erase(std::find(freeList.begin(), freeList.end(), alloc));
+    mStats.retainedBytes -= alloc->key.sizeClass;
+    mStats.retainedCount--;
+    mStats.evictions++;
+    return alloc;
+  }
+
+  // Frees retained allocations, oldest first, and then unused slabs until numBytes more fit in the budget
+  void makeRoom(uint64_t numBytes) {
+    bool overBudget = false;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      overBudget = mStats.allocatedBytes + numBytes > mStats.budgetBytes;
+    }
+    if (overBudget)
+      waitPending(); // pending releases will return allocations that can then be evicted
+
+    std::vector<clAllocation *> toFree;
+    std::vector<clSlab *> slabsToFree;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      uint64_t projectedBytes = mStats.allocatedBytes + numBytes;
+      while ((projectedBytes > mStats.budgetBytes) && !mLru.empty()) {
+        clAllocation *alloc = evictOldest();
+        projectedBytes -= alloc->key.sizeClass;
+        toFree.push_back(alloc);
+      }
+      for (auto slabIter = mSlabs.begin(); (projectedBytes > mStats.budgetBytes) && (slabIter != mSlabs.end()); ) {
+        clSlab *slab = *slabIter;
+        if (0 == slab->blocksInUse) {
+          removeSlabBlocks(slab);
+          projectedBytes -= slab->numBytes;
+          mStats.slabBytes -= slab->numBytes;
+          mStats.evictions++;
+          slabsToFree.push_back(slab);
+          slabIter = mSlabs.erase(slabIter);
+        } else
+          ++slabIter;
+      }
+    }
+    for (auto alloc: toFree)
+      destroyAllocation(alloc);
+    for (auto slab: slabsToFree)
+      destroySlab(slab);
+  }
+
+  void removeSlabBlocks(clSlab *slab) {
+    auto& blockFreeList = mBlockFreeLists[slab->blocks[0].key];
+    blockFreeList.erase(std::remove_if(blockFreeList.begin(), blockFreeList.end(),
+      [slab](clAllocation *block) { return block->slab == slab; }), blockFreeList.end());
+  }
+
+  clAllocation *acquireBlock(eMemFlags memFlags, eSvmType svmType, size_t numBytes) {
+    allocKey key = { slabBlockSize(numBytes, mBaseAddrAlign), memFlags, svmType };
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& blockFreeList = mBlockFreeLists[key];
+        if (!blockFreeList.empty()) {
+          clAllocation *block = blockFreeList.back();
+          blockFreeList.pop_back();
+          block->slab->blocksInUse++;
+          mStats.slabBlocksInUse++;
+          mStats.hits++;
+          return block;
+        }
+      }
+      if ((attempt > 0) || !isPending(key, true))
+        break;
+      waitPending();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStats.misses++;
+    }
+
+    clSlab *slab = createSlab(key);
+    if (!slab)
+      return nullptr;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSlabs.push_back(slab);
+    mStats.slabBytes += slab->numBytes;
+    auto& blockFreeList = mBlockFreeLists[key];
+    for (size_t b = slab->blocks.size() - 1; b > 0; --b)
+      blockFreeList.push_back(&slab->blocks[b]);
+    slab->blocksInUse = 1;
+    mStats.slabBlocksInUse++;
+    return &slab->blocks[0];
+  }
+
+  clSlab *createSlab(const allocKey& key) {
+    const size_t minSlabBytes = 1 << 20;
+    const size_t minSlabBlocks = 16;
+    size_t slabBytes = std::max(minSlabBytes, key.sizeClass * minSlabBlocks);
+    makeRoom(slabBytes);
+
+    clSlab *slab = new clSlab;
+    slab->numBytes = slabBytes;
+    clAllocation parent;
+    parent.key = key;
+    parent.key.sizeClass = slabBytes;
+    if (!createAllocation(&parent)) {
+      delete slab;
+      return nullptr;
+    }
+    slab->parentMem = parent.pinnedMem;
+    slab->parentHostBuf = parent.hostBuf;
+
+    size_t numBlocks = slabBytes / key.sizeClass;
+    slab->blocks.resize(numBlocks);
+    for (size_t b = 0; b < numBlocks; ++b) {
+      cl_int error = CL_SUCCESS;
+      cl_buffer_region region = { b * key.sizeClass, key.sizeClass };
+      clAllocation& block = slab->blocks[b];
+      block.key = key;
+      block.slab = slab;
+      block.pinnedMem = clCreateSubBuffer(slab->parentMem, 0, CL_BUFFER_CREATE_TYPE_REGION, &region, &error);
+      if (CL_SUCCESS != error) {
+        printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+          __FILE__, __LINE__, error, clGetErrorString(error));
+        destroySlab(slab);
+        return nullptr;
+      }
+      if (slab->parentHostBuf)
+        block.hostBuf = (uint8_t *)slab->parentHostBuf + region.origin;
+    }
+    return slab;
+  }
+
+  void destroySlab(clSlab *slab) {
+    cl_int error = CL_SUCCESS;
+    for (auto& block: slab->blocks) {
+      if (block.pinnedMem) {
+        error = clReleaseMemObject(block.pinnedMem);
+        if (CL_SUCCESS != error)
+          printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+            __FILE__, __LINE__, error, clGetErrorString(error));
+      }
+    }
+
+    clAllocation parent;
+    parent.key = slab->blocks.empty() ? allocKey() : slab->blocks[0].key;
+    parent.key.sizeClass = slab->numBytes;
+    parent.pinnedMem = slab->parentMem;
+    parent.hostBuf = slab->parentHostBuf;
+    destroyAllocation(&parent, false);
+    delete slab;
+  }
+
+  bool createAllocation(clAllocation *alloc) {
+    cl_int error = CL_SUCCESS;
+    const allocKey& key = alloc->key;
+    cl_mem_flags clMemFlags = (eMemFlags::READONLY == key.memFlags) ? CL_MEM_READ_ONLY :
+                              (eMemFlags::WRITEONLY == key.memFlags) ? CL_MEM_WRITE_ONLY :
+                              CL_MEM_READ_WRITE;
+    cl_svm_mem_flags clSvmMemFlags = clMemFlags;
+    if (eSvmType::FINE == key.svmType)
+      clSvmMemFlags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+
+    switch (key.svmType) {
+    case eSvmType::FINE:
+    case eSvmType::COARSE:
+      // page align so that an image can be created over the buffer
+      alloc->hostBuf = clSVMAlloc(mContext, clSvmMemFlags, key.sizeClass, 4096);
+      if (!alloc->hostBuf)
+        return false;
+      alloc->pinnedMem = clCreateBuffer(mContext, clMemFlags | CL_MEM_USE_HOST_PTR, key.sizeClass, alloc->hostBuf, &error);
+      break;
+    case eSvmType::STAGED:
+      // device-only memory, with the host copy in ordinary memory
+      alloc->hostBuf = new (std::nothrow) uint8_t[key.sizeClass];
+      if (!alloc->hostBuf)
+        return false;
+      alloc->pinnedMem = clCreateBuffer(mContext, clMemFlags, key.sizeClass, nullptr, &error);
+      break;
+    case eSvmType::NONE:
+    default:
+      alloc->pinnedMem = clCreateBuffer(mContext, clMemFlags | CL_MEM_ALLOC_HOST_PTR, key.sizeClass, nullptr, &error);
+      break;
+    }
+
+    if (CL_SUCCESS != error) {
+      printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+        __FILE__, __LINE__, error, clGetErrorString(error));
+      destroyAllocation(alloc, false);
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.allocatedBytes += key.sizeClass;
+    mStats.peakAllocatedBytes = std::max(mStats.peakAllocatedBytes, mStats.allocatedBytes);
+    return true;
+  }
+
+  void destroyAllocation(clAllocation *alloc, bool deleteAlloc = true) {
+    cl_int error = CL_SUCCESS;
+    for (auto& view: alloc->imageViews) {
+      error = clReleaseMemObject(view.imageMem);
+      if (CL_SUCCESS != error)
+        printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+          __FILE__, __LINE__, error, clGetErrorString(error));
+    }
+
+    if (alloc->pinnedMem) {
+      error = clReleaseMemObject(alloc->pinnedMem);
+      if (CL_SUCCESS != error)
+        printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+          __FILE__, __LINE__, error, clGetErrorString(error));
+
+      // only allocations that were fully created are counted
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStats.allocatedBytes -= alloc->key.sizeClass;
+    }
+
+    if (alloc->hostBuf && (eSvmType::STAGED == alloc->key.svmType))
+      delete[] (uint8_t *)alloc->hostBuf;
+    else if (alloc->hostBuf && (eSvmType::NONE != alloc->key.svmType))
+      clSVMFree(mContext, alloc->hostBuf);
+
+    alloc->imageViews.clear();
+    alloc->pinnedMem = nullptr;
+    alloc->hostBuf = nullptr;
+    if (deleteAlloc)
+      delete alloc;
+  }
+};
+
+std::shared_ptr<iClMemPool> iClMemPool::create(cl_context context, uint64_t maxRetainedBytes,
+                                               uint64_t slabMaxBytes, uint32_t baseAddrAlign, uint64_t maxAllocBytes,
+                                               uint64_t budgetBytes) {
+  return std::make_shared<clMemPool>(context, maxRetainedBytes, slabMaxBytes, baseAddrAlign, maxAllocBytes, budgetBytes);
+}
@@ -0,0 +1,124 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef CL_MEM_POOL_H
+#define CL_MEM_POOL_H
+
+#ifdef __APPLE__
+    #include "OpenCL/opencl.h"
+#else
+    #include "CL/cl.h"
+#endif
+#include <stdint.h>
+#include <memory>
+#include <array>
+#include <list>
+#include <vector>
+#include "cl_memory.h"
+
+// Key used to match a released allocation with a new request
+struct allocKey {
+  size_t sizeClass;
+  eMemFlags memFlags;
+  eSvmType svmType;
+
+  bool operator==(const allocKey& k) const {
+    return (sizeClass == k.sizeClass) && (memFlags == k.memFlags) && (svmType == k.svmType);
+  }
+};
+
+// Shape of an image object used to view an allocation
+struct imageViewKey {
+  cl_mem_object_type imageType;
+  cl_image_format imageFormat;
+  std::array<size_t, 3> region; // pixels, with array layers in the dimension after the image dimensions
+  size_t rowPitch; // non-zero for a 2D image created over the buffer memory
+
+  bool operator==(const imageViewKey& k) const {
+    return (imageType == k.imageType) && (region == k.region) && (rowPitch == k.rowPitch) &&
+           (imageFormat.image_channel_order == k.imageFormat.image_channel_order) &&
+           (imageFormat.image_channel_data_type == k.imageFormat.image_channel_data_type);
+  }
+};
+
+struct imageView {
+  imageViewKey key;
+  cl_mem imageMem;
+  bool shared; // imageMem is created over the buffer memory, so no copies are needed to keep them in sync
+};
+
+// Size that an allocation of numBytes is rounded up to in the pool
+size_t allocSizeClass(size_t numBytes);
+
+struct clSlab;
+
+// OpenCL objects backing a single clMemory, owned by the pool between uses
+struct clAllocation {
+  allocKey key;
+  cl_mem pinnedMem = nullptr;
+  // image objects created lazily for each shape that the allocation has been used as, most recent last
+  std::vector<imageView> imageViews;
+  void *hostBuf = nullptr;
+  clSlab *slab = nullptr; // set for a sub-buffer block carved from a shared parent allocation
+  std::list<clAllocation *>::iterator lruIter; // position in the pool's least-recently-used order while retained
+};
+
+struct poolStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t retainedBytes = 0;
+  uint64_t retainedCount = 0;
+  uint64_t maxRetainedBytes = 0;
+  uint64_t slabMaxBytes = 0;
+  uint64_t slabBytes = 0;
+  uint64_t slabBlocksInUse = 0;
+  uint64_t allocatedBytes = 0;
+  uint64_t peakAllocatedBytes = 0;
+  uint64_t budgetBytes = 0;
+  uint64_t evictions = 0;
+  uint64_t pendingReleases = 0;
+  uint64_t pendingReleaseBytes = 0;
+};
+
+class iClMemPool {
+public:
+  virtual ~iClMemPool() {}
+
+  // Buffers of up to slabMaxBytes that are not used for images are sub-allocated from shared slabs,
+  // with block offsets aligned to baseAddrAlign bytes. Size classes are not rounded up beyond maxAllocBytes.
+  // Least recently used retained allocations are freed before a new allocation would take the total
+  // OpenCL memory created by the pool over budgetBytes.
+  static std::shared_ptr<iClMemPool> create(cl_context context, uint64_t maxRetainedBytes,
+                                            uint64_t slabMaxBytes, uint32_t baseAddrAlign, uint64_t maxAllocBytes,
+                                            uint64_t budgetBytes);
+
+  // Returns an allocation of at least numBytes, either recycled or newly created, or nullptr on failure
+  virtual clAllocation *acquire(eMemFlags memFlags, eSvmType svmType, size_t numBytes, bool forImage) = 0;
+  // Hands an allocation back to the pool on a background thread once the fence events are complete, so that
+  // it is neither reused nor freed while queued work may still use it. It is then freed if the retained bytes
+  // limit would be exceeded. The pool takes ownership of the events.
+  virtual void release(clAllocation *alloc, const std::vector<cl_event>& fences) = 0;
+  // Releases an OpenCL buffer that does not belong to the pool, such as one over wrapped host memory, on the same
+  // background thread once the fence events are complete. Then calls released with releasedData, if set, from that
+  // thread. The pool takes ownership of the buffer and the events.
+  virtual void releaseExternal(cl_mem mem, const std::vector<cl_event>& fences, void (*released)(void *),
+                               void *releasedData) = 0;
+  // Frees all retained allocations and unused slabs, returning the number of bytes released
+  virtual uint64_t trim() = 0;
+
+  virtual poolStats stats() const = 0;
+};
+
+#endif
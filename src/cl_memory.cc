@@ -14,17 +14,83 @@
 */
 
 #include "cl_memory.h"
+#include "cl_mem_pool.h"
+#include "cl_staging.h"
+#include "host_copy.h"
 #include "noden_context.h"
 #include "noden_program.h"
 #include "noden_util.h"
 #include <cstring>
+#include <algorithm>
+
+size_t imagePixelBytes(const cl_image_format& imageFormat) {
+  switch (imageFormat.image_channel_data_type) {
+  case CL_UNORM_SHORT_565:
+  case CL_UNORM_SHORT_555:
+    return 2;
+  case CL_UNORM_INT_101010:
+    return 4;
+  default:
+    break;
+  }
+
+  size_t channelBytes = 0;
+  switch (imageFormat.image_channel_data_type) {
+  case CL_SNORM_INT8:
+  case CL_UNORM_INT8:
+  case CL_SIGNED_INT8:
+  case CL_UNSIGNED_INT8:
+    channelBytes = 1; break;
+  case CL_SNORM_INT16:
+  case CL_UNORM_INT16:
+  case CL_SIGNED_INT16:
+  case CL_UNSIGNED_INT16:
+  case CL_HALF_FLOAT:
+    channelBytes = 2; break;
+  case CL_SIGNED_INT32:
+  case CL_UNSIGNED_INT32:
+  case CL_FLOAT:
+    channelBytes = 4; break;
+  default:
+    return 0;
+  }
+
+  size_t numChannels = 0;
+  switch (imageFormat.image_channel_order) {
+  case CL_R:
+  case CL_A:
+  case CL_Rx:
+  case CL_INTENSITY:
+  case CL_LUMINANCE:
+  case CL_DEPTH:
+    numChannels = 1; break;
+  case CL_RG:
+  case CL_RA:
+  case CL_RGx:
+    numChannels = 2; break;
+  case CL_RGB:
+  case CL_RGBx:
+  case CL_sRGB:
+  case CL_sRGBx:
+    numChannels = 3; break;
+  case CL_RGBA:
+  case CL_BGRA:
+  case CL_ARGB:
+  case CL_ABGR:
+  case CL_sRGBA:
+  case CL_sBGRA:
+    numChannels = 4; break;
+  default:
+    return 0;
+  }
+  return numChannels * channelBytes;
+}
 
 class iGpuAccess {
 public:
   virtual ~iGpuAccess() {}
   virtual cl_int unmapMem(uint32_t queueNum) = 0;
-  virtual cl_int getKernelMem(iRunParams *runParams, bool isImageParam,
-                              iKernelArg::eAccess access, bool &isSVM, void *&kernelMem, uint32_t queueNum) = 0;
+  virtual cl_int getKernelMem(cl_mem_object_type imageType, iKernelArg::eAccess access, bool &isSVM, void *&kernelMem, uint32_t queueNum) = 0;
   virtual void onGpuReturn() = 0;
 };
 
@@ -36,15 +102,15 @@ public:
     mGpuAccess->onGpuReturn();
   }
 
-  cl_int setKernelParam(cl_kernel kernel, uint32_t paramIndex, bool isImageParam,
-                        iKernelArg::eAccess access, iRunParams *runParams, uint32_t queueNum) {
+  cl_int setKernelParam(cl_kernel kernel, uint32_t paramIndex, cl_mem_object_type imageType,
+                        iKernelArg::eAccess access, uint32_t queueNum) {
     cl_int error = CL_SUCCESS;
     error = mGpuAccess->unmapMem(queueNum);
     PASS_CL_ERROR;
 
     bool isSVM = false;
     void *kernelMem = nullptr;
-    error = mGpuAccess->getKernelMem(runParams, isImageParam, access, isSVM, kernelMem, queueNum);
+    error = mGpuAccess->getKernelMem(imageType, access, isSVM, kernelMem, queueNum);
     PASS_CL_ERROR;
 
     if (isSVM)
@@ -61,143 +127,340 @@ private:
 class clMemory : public iClMemory, public iGpuAccess {
 public:
   clMemory(cl_context context, std::vector<cl_command_queue> commandQueues, eMemFlags memFlags, eSvmType svmType, 
-           uint32_t numBytes, deviceInfo *devInfo, const std::array<uint32_t, 3>& imageDims)
+           size_t numBytes, deviceInfo *devInfo, const std::array<uint32_t, 3>& imageDims,
+           const cl_image_format& imageFormat, std::shared_ptr<iClMemPool> memPool,
+           std::shared_ptr<iHostCopy> hostCopy, std::shared_ptr<iStagingRing> staging, void *wrapPtr = nullptr)
     : mContext(context), mCommandQueues(commandQueues), mMemFlags(memFlags), mSvmType(svmType),
-      mNumBytes(numBytes), mDevInfo(devInfo), mImageDims(imageDims),
-      mPinnedMem(nullptr), mImageMem(nullptr), mHostBuf(nullptr), mGpuLocked(false), mHostMapped(false),
-      mMapFlags(eMemFlags::NONE), mMemLatest(eMemLatest::BUFFER) {}
+      mNumBytes(numBytes), mDevInfo(devInfo), mImageDims(imageDims), mImageFormat(imageFormat),
+      mMemPool(memPool), mHostCopy(hostCopy), mStaging(staging), mWrapPtr(wrapPtr),
+      mWrapReleased(nullptr), mWrapReleasedData(nullptr), mAlloc(nullptr),
+      mPinnedMem(nullptr), mImageMem(nullptr), mImageType(0), mImageKey(), mImageShared(false), mHostBuf(nullptr), mGpuLocked(false), mFreed(false), mHostMapped(false),
+      mMapFlags(eMemFlags::NONE), mMapOffset(0), mMapBytes(0), mMemLatest(eMemLatest::BUFFER),
+      mPersistentMap(devInfo->unifiedMemory && (eSvmType::FINE == svmType)),
+      mUnifiedMap(devInfo->unifiedMemory && (eSvmType::NONE == svmType)), mGpuPending(false), mGpuQueueNum(0) {}
   ~clMemory() {
     freeAllocation();
   }
 
   bool allocate() {
-    cl_int error = CL_SUCCESS;
-    cl_mem_flags clMemFlags = (eMemFlags::READONLY == mMemFlags) ? CL_MEM_READ_ONLY :
-                              (eMemFlags::WRITEONLY == mMemFlags) ? CL_MEM_WRITE_ONLY :
-                              CL_MEM_READ_WRITE;
-    cl_svm_mem_flags clSvmMemFlags = clMemFlags;
-    if (eSvmType::FINE == mSvmType)
-      clSvmMemFlags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+    if (mWrapPtr) {
+      if (wrapHostPtr())
+        return true;
+      // the host memory cannot be used directly, so the caller copies it into a buffer from the pool instead
+      mWrapPtr = nullptr;
+    }
+
+    mAlloc = mMemPool->acquire(mMemFlags, mSvmType, mNumBytes, hasDimensions());
+    if (!mAlloc)
+      return false;
+    mPinnedMem = mAlloc->pinnedMem;
+    mMemLatest = eMemLatest::BUFFER;
 
     switch (mSvmType) {
     case eSvmType::FINE:
     case eSvmType::COARSE:
-      mHostBuf = clSVMAlloc(mContext, clSvmMemFlags, mNumBytes, 0);
-      mPinnedMem = clCreateBuffer(mContext, clMemFlags | CL_MEM_USE_HOST_PTR, mNumBytes, mHostBuf, &error);
+      mHostBuf = mAlloc->hostBuf;
+      break;
+    case eSvmType::STAGED:
+      // the host copy starts out available, uploaded at first device use unless the kernel only writes the buffer
+      mHostBuf = mAlloc->hostBuf;
+      mHostMapped = true;
+      mMapFlags = (eMemFlags::WRITEONLY == mMemFlags) ? eMemFlags::READONLY : eMemFlags::READWRITE;
+      mMapOffset = 0;
+      mMapBytes = mNumBytes;
       break;
     case eSvmType::NONE:
-    default:
-      mPinnedMem = clCreateBuffer(mContext, clMemFlags | CL_MEM_ALLOC_HOST_PTR, mNumBytes, nullptr, &error);
-      if (CL_SUCCESS == error) {
-        cl_map_flags clMapFlags = (eMemFlags::READONLY == mMemFlags) ? CL_MAP_WRITE_INVALIDATE_REGION : 
-                                  (eMemFlags::WRITEONLY == mMemFlags) ? CL_MAP_READ :
-                                  CL_MAP_READ | CL_MAP_WRITE;
-        mHostBuf = clEnqueueMapBuffer(mCommandQueues[0], mPinnedMem, CL_TRUE, clMapFlags, 0, mNumBytes, 0, nullptr, nullptr, nullptr);
-      } else
+    default: {
+      cl_int error = CL_SUCCESS;
+      cl_map_flags clMapFlags = mUnifiedMap ? CL_MAP_READ | CL_MAP_WRITE :
+                                (eMemFlags::READONLY == mMemFlags) ? CL_MAP_WRITE_INVALIDATE_REGION : 
+                                (eMemFlags::WRITEONLY == mMemFlags) ? CL_MAP_READ :
+                                CL_MAP_READ | CL_MAP_WRITE;
+      mHostBuf = clEnqueueMapBuffer(mCommandQueues[0], mPinnedMem, CL_TRUE, clMapFlags, 0, mNumBytes, 0, nullptr, nullptr, &error);
+      if (CL_SUCCESS != error)
         printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
           __FILE__, __LINE__, error, clGetErrorString(error));
       mHostMapped = true;
-      mMapFlags = (eMemFlags::READONLY == mMemFlags) ? eMemFlags::WRITEONLY : eMemFlags::READWRITE;
+      mMapFlags = (eMemFlags::READONLY == mMemFlags) && !mUnifiedMap ? eMemFlags::WRITEONLY : eMemFlags::READWRITE;
+      mMapOffset = 0;
+      mMapBytes = mNumBytes;
       break;
     }
+    }
 
     return nullptr != mHostBuf;
   }
 
   std::shared_ptr<iGpuMemory> getGPUMemory() {
-    // printf("getGpuMemory type %d, host mapped %s, numBytes %d\n", mSvmType, mHostMapped?"true":"false", mNumBytes);
+    // printf("getGpuMemory type %d, host mapped %s, numBytes %zu\n", mSvmType, mHostMapped?"true":"false", mNumBytes);
     mGpuLocked = true;
     return std::make_shared<gpuMemory>(this);
   }
 
-  cl_int setHostAccess(eMemFlags haFlags, uint32_t queueNum) {
+  cl_int setHostAccess(eMemFlags haFlags, uint32_t queueNum, size_t offset, size_t numBytes, bool blocking) {
     cl_int error = CL_SUCCESS;
     if (mGpuLocked) {
-      printf("GPU buffer access must be released before host access - %d\n", mNumBytes);
+      printf("GPU buffer access must be released before host access - %zu\n", mNumBytes);
       error = CL_MAP_FAILURE;
       return error;
     }
+    error = checkAllocated("host access");
+    PASS_CL_ERROR;
+
+    if (mPersistentMap)
+      return syncPersistentMap(haFlags, queueNum, blocking);
+    if (mUnifiedMap && mHostMapped && (eMemFlags::NONE != haFlags)) {
+      if (eMemFlags::READONLY != haFlags)
+        mMemLatest = eMemLatest::BUFFER;
+      return error; // the whole buffer is already mapped for read and write
+    }
 
-    if (mHostMapped && (haFlags != mMapFlags)) {
-      error = unmapMem(queueNum); // must unmap if host access flags don't match
+    bool sameRegion = (offset == mMapOffset) && (numBytes == mMapBytes);
+    if (mHostMapped && sameRegion && (eSvmType::STAGED == mSvmType) &&
+        ((eMemFlags::WRITEONLY == haFlags) || (eMemFlags::READWRITE == haFlags))) {
+      mMapFlags = haFlags; // the host copy is current and will be uploaded when access is released
+      return error;
+    }
+    if (mHostMapped && ((haFlags != mMapFlags) || !sameRegion)) {
+      error = unmapMem(queueNum); // must unmap if host access flags or region don't match
       PASS_CL_ERROR;
     }
 
     if (!mHostMapped && !(eMemFlags::NONE == haFlags)) {
-      cl_map_flags mapFlags = (eMemFlags::READWRITE == haFlags) ? CL_MAP_WRITE | CL_MAP_READ :
-                              (eMemFlags::WRITEONLY == haFlags) ? CL_MAP_WRITE_INVALIDATE_REGION :
+      // with unified memory a map needs no copy, so the whole buffer is mapped for read and write to let
+      // host access with other flags or regions reuse the mapping until the next kernel use
+      eMemFlags mapAccess = mUnifiedMap ? eMemFlags::READWRITE : haFlags;
+      if (mUnifiedMap) {
+        offset = 0;
+        numBytes = mNumBytes;
+      }
+      cl_map_flags mapFlags = (eMemFlags::READWRITE == mapAccess) ? CL_MAP_WRITE | CL_MAP_READ :
+                              (eMemFlags::WRITEONLY == mapAccess) ? CL_MAP_WRITE_INVALIDATE_REGION :
                               CL_MAP_READ;
-      if (mImageMem && (mDevInfo->oclVer < clVersion(2,0))) {
-        if (eMemFlags::WRITEONLY == haFlags)
-          mMemLatest = eMemLatest::BUFFER;
-        else {
+      if (mImageMem && !mImageShared) {
+        if ((eMemFlags::WRITEONLY != haFlags) && (eMemLatest::IMAGE == mMemLatest)) {
           error = copyImageToBuffer(queueNum);
           PASS_CL_ERROR;
         }
+        if (eMemFlags::READONLY != haFlags)
+          mMemLatest = eMemLatest::BUFFER;
       }
 
-      cl_bool blockingMap = mCommandQueues.size() > 1 ? CL_NON_BLOCKING : CL_BLOCKING;
+      cl_bool blockingMap = (blocking && (1 == mCommandQueues.size())) ? CL_BLOCKING : CL_NON_BLOCKING;
       if (eSvmType::NONE == mSvmType) {
-        void *hostBuf = clEnqueueMapBuffer(getCommandQueue(queueNum), mPinnedMem, blockingMap, mapFlags, 0, mNumBytes, 0, nullptr, nullptr, &error);
+        void *hostBuf = clEnqueueMapBuffer(getCommandQueue(queueNum), mPinnedMem, blockingMap, mapFlags, offset, numBytes, 0, nullptr, nullptr, &error);
         PASS_CL_ERROR;
-        if (mHostBuf != hostBuf) {
-          printf("Unexpected behaviour - mapped buffer address is not the same: %p != %p\n", mHostBuf, hostBuf);
+        if ((uint8_t *)mHostBuf + offset != hostBuf) {
+          printf("Unexpected behaviour - mapped buffer address is not the same: %p != %p\n", (uint8_t *)mHostBuf + offset, hostBuf);
           error = CL_MAP_FAILURE;
           return error;
         }
         mHostMapped = true;
       } else if (eSvmType::COARSE == mSvmType) {
-        error = clEnqueueSVMMap(getCommandQueue(queueNum), blockingMap, mapFlags, mHostBuf, mNumBytes, 0, nullptr, nullptr);
+        error = clEnqueueSVMMap(getCommandQueue(queueNum), blockingMap, mapFlags, (uint8_t *)mHostBuf + offset, numBytes, 0, nullptr, nullptr);
         PASS_CL_ERROR;
         mHostMapped = true;
+      } else if (eSvmType::STAGED == mSvmType) {
+        // the host copy must hold the data before the promise resolves, whatever the queue layout
+        if (eMemFlags::WRITEONLY != haFlags) {
+          error = mStaging->download(getCommandQueue(queueNum), mPinnedMem, offset, (uint8_t *)mHostBuf + offset, numBytes);
+          PASS_CL_ERROR;
+        }
+        mHostMapped = true;
       }
 
-      mMapFlags = haFlags;
+      mMapFlags = mapAccess;
+      mMapOffset = offset;
+      mMapBytes = numBytes;
+    }
+    return error;
+  }
+
+  cl_int hostAccessEvent(uint32_t queueNum, cl_event *event) {
+    cl_int error = CL_SUCCESS;
+    *event = nullptr;
+    if (1 == mCommandQueues.size()) {
+      error = clEnqueueMarkerWithWaitList(getCommandQueue(queueNum), 0, nullptr, event);
+      PASS_CL_ERROR;
+      error = clFlush(getCommandQueue(queueNum));
+    }
+    return error;
+  }
+
+  cl_int copyFrom(const void *srcBuf, size_t numBytes) {
+    cl_int error = checkAllocated("copy from the host");
+    PASS_CL_ERROR;
+    mHostCopy->copy(mHostBuf, srcBuf, numBytes);
+    return error;
+  }
+
+  cl_int copyTo(iClMemory *dst, size_t srcOffset, size_t dstOffset, size_t numBytes, uint32_t queueNum) {
+    clMemory *dstMem = static_cast<clMemory *>(dst);
+    cl_int error = prepareCopy(dstMem, queueNum);
+    PASS_CL_ERROR;
+
+    if (isSvm() && dstMem->isSvm())
+      error = clEnqueueSVMMemcpy(getCommandQueue(queueNum), CL_NON_BLOCKING, (uint8_t *)dstMem->mHostBuf + dstOffset,
+                                 (uint8_t *)mHostBuf + srcOffset, numBytes, 0, nullptr, nullptr);
+    else
+      error = clEnqueueCopyBuffer(getCommandQueue(queueNum), mPinnedMem, dstMem->mPinnedMem,
+                                  srcOffset, dstOffset, numBytes, 0, nullptr, nullptr);
+    PASS_CL_ERROR;
+    dstMem->mMemLatest = eMemLatest::BUFFER;
+    return error;
+  }
+
+  cl_int copyRectTo(iClMemory *dst, const std::array<size_t, 3>& srcOrigin, const std::array<size_t, 3>& dstOrigin,
+                    const std::array<size_t, 3>& region, size_t srcRowPitch, size_t srcSlicePitch,
+                    size_t dstRowPitch, size_t dstSlicePitch, uint32_t queueNum) {
+    clMemory *dstMem = static_cast<clMemory *>(dst);
+    cl_int error = prepareCopy(dstMem, queueNum);
+    PASS_CL_ERROR;
+
+    error = clEnqueueCopyBufferRect(getCommandQueue(queueNum), mPinnedMem, dstMem->mPinnedMem,
+                                    srcOrigin.data(), dstOrigin.data(), region.data(),
+                                    srcRowPitch, srcSlicePitch, dstRowPitch, dstSlicePitch, 0, nullptr, nullptr);
+    PASS_CL_ERROR;
+    dstMem->mMemLatest = eMemLatest::BUFFER;
+    return error;
+  }
+
+  cl_int fill(const void *pattern, size_t patternBytes, size_t offset, size_t size, uint32_t queueNum) {
+    cl_int error = CL_SUCCESS;
+    if (mGpuLocked) {
+      printf("GPU buffer access must be released before buffer fill - %zu\n", mNumBytes);
+      error = CL_INVALID_OPERATION;
+      return error;
+    }
+    error = checkAllocated("buffer fill");
+    PASS_CL_ERROR;
+    error = unmapMem(queueNum);
+    PASS_CL_ERROR;
+
+    // a partial fill must not lose newer data held in the image
+    if (mImageMem && !mImageShared && (eMemLatest::IMAGE == mMemLatest) && (size < mNumBytes)) {
+      error = copyImageToBuffer(queueNum);
+      PASS_CL_ERROR;
     }
+
+    if (!isSvm())
+      error = clEnqueueFillBuffer(getCommandQueue(queueNum), mPinnedMem, pattern, patternBytes, offset, size, 0, nullptr, nullptr);
+    else
+      error = clEnqueueSVMMemFill(getCommandQueue(queueNum), (uint8_t *)mHostBuf + offset, pattern, patternBytes, size, 0, nullptr, nullptr);
+    PASS_CL_ERROR;
+    mMemLatest = eMemLatest::BUFFER;
+
+    if (1 == mCommandQueues.size())
+      error = clFinish(getCommandQueue(queueNum));
+    return error;
+  }
+
+  cl_int fillImage(const void *fillColour, uint32_t queueNum) {
+    cl_int error = CL_SUCCESS;
+    if (mGpuLocked) {
+      printf("GPU buffer access must be released before image fill - %zu\n", mNumBytes);
+      error = CL_INVALID_OPERATION;
+      return error;
+    }
+    error = checkAllocated("image fill");
+    PASS_CL_ERROR;
+    error = unmapMem(queueNum);
+    PASS_CL_ERROR;
+
+    // fill the image view last used by a kernel, if any
+    error = selectImage(mImageMem ? mImageType : mImageDims[2] > 1 ? CL_MEM_OBJECT_IMAGE3D : CL_MEM_OBJECT_IMAGE2D, queueNum);
+    PASS_CL_ERROR;
+
+    const size_t origin[3] = { 0, 0, 0 };
+    std::array<size_t, 3> region = imageRegion(mImageType);
+    error = clEnqueueFillImage(getCommandQueue(queueNum), mImageMem, fillColour, origin, region.data(), 0, nullptr, nullptr);
+    PASS_CL_ERROR;
+    mMemLatest = mImageShared ? eMemLatest::SAME : eMemLatest::IMAGE;
+
+    if (1 == mCommandQueues.size())
+      error = clFinish(getCommandQueue(queueNum));
     return error;
   }
 
-  cl_int copyFrom(const void *srcBuf, size_t numBytes, uint32_t queueNum) {
+  cl_int migrate(bool toHost, uint32_t queueNum) {
     cl_int error = CL_SUCCESS;
+    if (mGpuLocked) {
+      printf("GPU buffer access must be released before migration - %zu\n", mNumBytes);
+      error = CL_INVALID_OPERATION;
+      return error;
+    }
+    error = checkAllocated("migration");
+    PASS_CL_ERROR;
+    if (mPersistentMap)
+      return error; // host and device already share the memory
 
-    // if (eSvmType::NONE == mSvmType)
-      memcpy(mHostBuf, srcBuf, numBytes);
-    // else
-    //   error = clEnqueueSVMMemcpy(getCommandQueue(queueNum), CL_BLOCKING, mHostBuf, srcBuf, numBytes, 0, nullptr, nullptr);
-    // PASS_CL_ERROR;
+    std::vector<cl_mem> memObjects(1, mPinnedMem);
+    if (toHost) {
+      // newer data held in an image must be in the buffer before it is moved to the host
+      if (mImageMem && !mImageShared && (eMemLatest::IMAGE == mMemLatest)) {
+        error = copyImageToBuffer(queueNum);
+        PASS_CL_ERROR;
+      }
+    } else {
+      error = unmapMem(queueNum);
+      PASS_CL_ERROR;
+      // the image view last used by a kernel is expected to be used again
+      if (mImageMem && !mImageShared)
+        memObjects.push_back(mImageMem);
+    }
+
+    cl_mem_migration_flags migrateFlags = toHost ? CL_MIGRATE_MEM_OBJECT_HOST : 0;
+#ifdef CL_VERSION_2_1
+    if (isSvm() && (mDevInfo->oclVer >= clVersion(2, 1)) && (1 == memObjects.size())) {
+      const void *svmPtr = mHostBuf;
+      error = clEnqueueSVMMigrateMem(getCommandQueue(queueNum), 1, &svmPtr, &mNumBytes, migrateFlags, 0, nullptr, nullptr);
+    } else
+#endif
+      error = clEnqueueMigrateMemObjects(getCommandQueue(queueNum), (cl_uint)memObjects.size(), memObjects.data(),
+                                         migrateFlags, 0, nullptr, nullptr);
+    PASS_CL_ERROR;
+
+    if (1 == mCommandQueues.size())
+      error = clFinish(getCommandQueue(queueNum));
     return error;
   }
 
   void freeAllocation() {
     cl_int error = CL_SUCCESS;
-    error = unmapMem(0);
+    if (eSvmType::STAGED == mSvmType)
+      mHostMapped = false; // the host copy is discarded rather than uploaded
+    error = unmapHost(0);
     if (CL_SUCCESS != error)
       printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
         __FILE__, __LINE__, error, clGetErrorString(error));
 
-    if (mHostBuf && (eSvmType::NONE != mSvmType))
-      clSVMFree(mContext, mHostBuf);
-
-    if (mImageMem) {
-      error = clReleaseMemObject(mImageMem);
-      if (CL_SUCCESS != error)
-        printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
-          __FILE__, __LINE__, error, clGetErrorString(error));
-    }
-
-    if (mPinnedMem) {
-      error = clReleaseMemObject(mPinnedMem);
-      if (CL_SUCCESS != error)
-        printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
-          __FILE__, __LINE__, error, clGetErrorString(error));
+    if (mAlloc) {
+      // image views stay with the allocation for reuse and are released by the pool once work queued so far
+      // is complete, which the markers signal in-order on every queue that could be using the allocation
+      mMemPool->release(mAlloc, enqueueFences());
+      mAlloc = nullptr;
+    } else if (mWrapPtr && mPinnedMem) {
+      // wrapped memory has no image dimensions, so it never has image views. The caller keeps the host memory
+      // until the pool has released the buffer after the fences.
+      mMemPool->releaseExternal(mPinnedMem, enqueueFences(), mWrapReleased, mWrapReleasedData);
+      mWrapReleased = nullptr;
+      mWrapReleasedData = nullptr;
     }
 
+    mFreed = true;
     mPinnedMem = nullptr;
     mImageMem = nullptr;
+    mImageType = 0;
+    mImageShared = false;
     mHostBuf = nullptr;
   }
 
-  uint32_t numBytes() const { return mNumBytes; }
+  void setWrapRelease(void (*released)(void *), void *releasedData) {
+    mWrapReleased = released;
+    mWrapReleasedData = releasedData;
+  }
+
+  size_t numBytes() const { return mNumBytes; }
   eMemFlags memFlags() const { return mMemFlags; }
   eSvmType svmType() const { return mSvmType; }
   std::string svmTypeName() const {
@@ -205,11 +468,14 @@ public:
     case eSvmType::FINE: return "fine";
     case eSvmType::COARSE: return "coarse";
     case eSvmType::NONE: return "none";
+    case eSvmType::STAGED: return "staged";
     default: return "unknown";
     }
   }
   void* hostBuf() const { return mHostBuf; }
+  bool isWrapped() const { return nullptr != mWrapPtr; }
   bool hasDimensions() const { return mImageDims[0] > 0; }
+  const cl_image_format& imageFormat() const { return mImageFormat; }
 
   enum class eMemLatest : uint8_t { BUFFER = 0, SAME = 1, IMAGE = 2 };
 
@@ -218,16 +484,38 @@ private:
   std::vector<cl_command_queue> mCommandQueues;
   const eMemFlags mMemFlags;
   const eSvmType mSvmType;
-  const uint32_t mNumBytes;
+  const size_t mNumBytes;
   deviceInfo *mDevInfo;
   const std::array<uint32_t, 3> mImageDims;
+  const cl_image_format mImageFormat;
+  std::shared_ptr<iClMemPool> mMemPool;
+  std::shared_ptr<iHostCopy> mHostCopy;
+  std::shared_ptr<iStagingRing> mStaging;
+  void *mWrapPtr;
+  void (*mWrapReleased)(void *);
+  void *mWrapReleasedData;
+  clAllocation *mAlloc;
   cl_mem mPinnedMem;
   cl_mem mImageMem;
+  cl_mem_object_type mImageType;
+  imageViewKey mImageKey;
+  bool mImageShared;
   void *mHostBuf;
   bool mGpuLocked;
+  bool mFreed;
   bool mHostMapped;
   eMemFlags mMapFlags;
+  size_t mMapOffset;
+  size_t mMapBytes;
   eMemLatest mMemLatest;
+  const bool mPersistentMap;
+  const bool mUnifiedMap;
+  bool mGpuPending;
+  uint32_t mGpuQueueNum;
+
+  static const size_t maxImageViews = 4;
+
+  bool isSvm() const { return (eSvmType::COARSE == mSvmType) || (eSvmType::FINE == mSvmType); }
 
   cl_command_queue getCommandQueue(uint32_t queueNum) {
     uint32_t q = queueNum;
@@ -238,97 +526,322 @@ private:
     return mCommandQueues.at(q);
   }
 
+  // Markers on every queue that could be using the memory, which complete in-order once the work queued so far is done
+  std::vector<cl_event> enqueueFences() {
+    std::vector<cl_event> fences;
+    for (auto commandQueue: mCommandQueues) {
+      cl_event fence;
+      cl_int error = clEnqueueMarkerWithWaitList(commandQueue, 0, nullptr, &fence);
+      if (CL_SUCCESS == error)
+        fences.push_back(fence);
+      else
+        printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+          __FILE__, __LINE__, error, clGetErrorString(error));
+    }
+    return fences;
+  }
+
+  // Wrapped host memory is owned by the caller, so the OpenCL buffer is created directly rather than from the pool.
+  // Mapping a CL_MEM_USE_HOST_PTR buffer gives back the host pointer, so the caller's contents are preserved.
+  bool wrapHostPtr() {
+    cl_int error = CL_SUCCESS;
+    cl_mem_flags clMemFlags = (eMemFlags::READONLY == mMemFlags) ? CL_MEM_READ_ONLY :
+                              (eMemFlags::WRITEONLY == mMemFlags) ? CL_MEM_WRITE_ONLY :
+                              CL_MEM_READ_WRITE;
+    mPinnedMem = clCreateBuffer(mContext, clMemFlags | CL_MEM_USE_HOST_PTR, mNumBytes, mWrapPtr, &error);
+    if (CL_SUCCESS != error) {
+      printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+        __FILE__, __LINE__, error, clGetErrorString(error));
+      mPinnedMem = nullptr;
+      return false;
+    }
+    mHostBuf = mWrapPtr;
+    mMemLatest = eMemLatest::BUFFER;
+
+    if (eSvmType::NONE == mSvmType) {
+      void *hostBuf = clEnqueueMapBuffer(mCommandQueues[0], mPinnedMem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, mNumBytes, 0, nullptr, nullptr, &error);
+      if (CL_SUCCESS != error) {
+        printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+          __FILE__, __LINE__, error, clGetErrorString(error));
+        releaseWrap(nullptr);
+        return false;
+      }
+      if (mHostBuf != hostBuf) {
+        printf("Unexpected behaviour - mapped buffer address is not the wrapped address: %p != %p\n", mHostBuf, hostBuf);
+        releaseWrap(hostBuf);
+        return false;
+      }
+      mHostMapped = true;
+      mMapFlags = eMemFlags::READWRITE;
+      mMapOffset = 0;
+      mMapBytes = mNumBytes;
+    }
+    return true;
+  }
+
+  // Undoes a wrap that could not be completed, unmapping mappedBuf first if the buffer was mapped
+  void releaseWrap(void *mappedBuf) {
+    if (mappedBuf) {
+      cl_int error = clEnqueueUnmapMemObject(mCommandQueues[0], mPinnedMem, mappedBuf, 0, nullptr, nullptr);
+      if (CL_SUCCESS == error)
+        error = clFinish(mCommandQueues[0]);
+      if (CL_SUCCESS != error)
+        printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+          __FILE__, __LINE__, error, clGetErrorString(error));
+    }
+    clReleaseMemObject(mPinnedMem);
+    mPinnedMem = nullptr;
+    mHostBuf = nullptr;
+  }
+
+  // A fine-grained SVM buffer on unified memory is never unmapped and GPU use is only recorded, for a fence at the
+  // next host access
   cl_int unmapMem(uint32_t queueNum) {
+    if (mPersistentMap) {
+      mGpuPending = true;
+      mGpuQueueNum = queueNum;
+      return CL_SUCCESS;
+    }
+    return unmapHost(queueNum);
+  }
+
+  cl_int unmapHost(uint32_t queueNum) {
     cl_int error = CL_SUCCESS;
     if (mHostMapped) {
+      void *mappedBuf = (uint8_t *)mHostBuf + mMapOffset;
       if (eSvmType::NONE == mSvmType)
-        error = clEnqueueUnmapMemObject(getCommandQueue(queueNum), mPinnedMem, mHostBuf, 0, nullptr, nullptr);
+        error = clEnqueueUnmapMemObject(getCommandQueue(queueNum), mPinnedMem, mappedBuf, 0, nullptr, nullptr);
       else if (eSvmType::COARSE == mSvmType)
-        error = clEnqueueSVMUnmap(getCommandQueue(queueNum), mHostBuf, 0, 0, nullptr);
+        error = clEnqueueSVMUnmap(getCommandQueue(queueNum), mappedBuf, 0, 0, nullptr);
+      else if ((eSvmType::STAGED == mSvmType) && (eMemFlags::READONLY != mMapFlags))
+        error = mStaging->upload(getCommandQueue(queueNum), mPinnedMem, mMapOffset, mappedBuf, mMapBytes, false);
       mHostMapped = false;
       mMapFlags = eMemFlags::NONE;
     }
     return error;
   }
 
-  cl_int copyImageToBuffer(uint32_t queueNum) {
+  // Host access to a persistently mapped buffer waits for GPU work that used the buffer with a marker on the
+  // queue that did the work. With overlapping queues, the marker is chained onto the host access queue instead,
+  // so that the hostAccess promise keeps its meaning of resolving when the work is enqueued.
+  cl_int syncPersistentMap(eMemFlags haFlags, uint32_t queueNum, bool blocking) {
     cl_int error = CL_SUCCESS;
-    if (mImageMem) {
-      const size_t origin[3] = { 0, 0, 0 };
-      size_t region[3] = { 1, 1, 1 };
-      error = clGetImageInfo(mImageMem, CL_IMAGE_WIDTH, sizeof(size_t), &region[0], NULL);
+    if (eMemFlags::NONE == haFlags)
+      return error;
+
+    if (mImageMem && !mImageShared) {
+      if ((eMemFlags::WRITEONLY != haFlags) && (eMemLatest::IMAGE == mMemLatest)) {
+        error = copyImageToBuffer(queueNum);
+        PASS_CL_ERROR;
+        mGpuPending = true;
+        mGpuQueueNum = queueNum;
+      }
+      if (eMemFlags::READONLY != haFlags)
+        mMemLatest = eMemLatest::BUFFER;
+    }
+
+    if (mGpuPending) {
+      cl_event gpuDone;
+      error = clEnqueueMarkerWithWaitList(getCommandQueue(mGpuQueueNum), 0, nullptr, &gpuDone);
       PASS_CL_ERROR;
-      size_t height = 0;
-      error = clGetImageInfo(mImageMem, CL_IMAGE_HEIGHT, sizeof(size_t), &height, NULL);
+      if (mCommandQueues.size() > 1) {
+        if (mGpuQueueNum != queueNum)
+          error = clEnqueueMarkerWithWaitList(getCommandQueue(queueNum), 1, &gpuDone, nullptr);
+      } else if (blocking)
+        error = clWaitForEvents(1, &gpuDone);
+      clReleaseEvent(gpuDone);
       PASS_CL_ERROR;
-      if (height) region[1] = height;
-      size_t depth = 0;
-      error = clGetImageInfo(mImageMem, CL_IMAGE_DEPTH, sizeof(size_t), &depth, NULL);
+      mGpuPending = false;
+    }
+    mMapFlags = haFlags;
+    return error;
+  }
+
+  // Once the allocation has been handed back to the pool it may be recycled for another buffer or freed
+  cl_int checkAllocated(const char *operation) const {
+    if (!mFreed)
+      return CL_SUCCESS;
+    printf("Buffer memory has been released before %s - %zu\n", operation, mNumBytes);
+    return CL_INVALID_MEM_OBJECT;
+  }
+
+  // Release host mappings and bring the source buffer up to date before a device-side copy
+  cl_int prepareCopy(clMemory *dstMem, uint32_t queueNum) {
+    cl_int error = CL_SUCCESS;
+    if (mGpuLocked || dstMem->mGpuLocked) {
+      printf("GPU buffer access must be released before buffer copy\n");
+      error = CL_INVALID_OPERATION;
+      return error;
+    }
+    error = checkAllocated("buffer copy");
+    PASS_CL_ERROR;
+    error = dstMem->checkAllocated("buffer copy");
+    PASS_CL_ERROR;
+
+    error = unmapMem(queueNum);
+    PASS_CL_ERROR;
+    error = dstMem->unmapMem(queueNum);
+    PASS_CL_ERROR;
+
+    if (mImageMem && !mImageShared && (eMemLatest::IMAGE == mMemLatest)) {
+      error = copyImageToBuffer(queueNum);
       PASS_CL_ERROR;
-      if (depth) region[2] = depth;
+    }
+    return error;
+  }
 
+  cl_int copyImageToBuffer(uint32_t queueNum) {
+    cl_int error = CL_SUCCESS;
+    if (mImageMem) {
+      const size_t origin[3] = { 0, 0, 0 };
+      std::array<size_t, 3> region = imageRegion(mImageType);
       // printf("Copying image memory to buffer size %zdx%zd\n", region[0], region[1]);
-      error = clEnqueueCopyImageToBuffer(getCommandQueue(queueNum), mImageMem, mPinnedMem, origin, region, 0, 0, nullptr, nullptr);
+      error = clEnqueueCopyImageToBuffer(getCommandQueue(queueNum), mImageMem, mPinnedMem, origin, region.data(), 0, 0, nullptr, nullptr);
       PASS_CL_ERROR;
+      mDevInfo->imageCopiesToBuffer++;
+      mDevInfo->imageCopyBytes += region[0] * region[1] * region[2] * imagePixelBytes(mImageFormat);
       mMemLatest = eMemLatest::SAME;
     }
     return error;
   }
 
-  cl_int getKernelMem(iRunParams *runParams, bool isImageParam,
-                      iKernelArg::eAccess access, bool &isSVM, void *&kernelMem, uint32_t queueNum) {
-    kernelMem = mImageMem ? &mImageMem : &mPinnedMem;
-    const size_t origin[3] = { 0, 0, 0 };
+  // Pixels of each image dimension. Arrays use the next dimension for the number of layers and
+  // a 1D buffer image covers all of the pixels given by the dimensions.
+  std::array<size_t, 3> imageRegion(cl_mem_object_type imageType) const {
+    size_t width = mImageDims[0];
+    size_t height = std::max<size_t>(mImageDims[1], 1);
+    size_t depth = std::max<size_t>(mImageDims[2], 1);
+    switch (imageType) {
+    case CL_MEM_OBJECT_IMAGE1D:
+      return {{ width, 1, 1 }};
+    case CL_MEM_OBJECT_IMAGE1D_BUFFER:
+      return {{ width * height * depth, 1, 1 }};
+    case CL_MEM_OBJECT_IMAGE1D_ARRAY:
+      return {{ width, height, 1 }};
+    case CL_MEM_OBJECT_IMAGE3D:
+    case CL_MEM_OBJECT_IMAGE2D_ARRAY:
+      return {{ width, height, depth }};
+    case CL_MEM_OBJECT_IMAGE2D:
+    default:
+      return {{ width, height, 1 }};
+    }
+  }
+
+  // Makes the image view of the given type for this buffer's dimensions and format the current one,
+  // syncing the previous view back to the buffer first. Views are created lazily and cached with the
+  // allocation, so a pooled allocation can be reused for other image shapes without a new allocation.
+  cl_int selectImage(cl_mem_object_type imageType, uint32_t queueNum) {
     cl_int error = CL_SUCCESS;
+    bool shared = canShareImage(imageType);
+    imageViewKey key = { imageType, mImageFormat, imageRegion(imageType),
+                         shared && (CL_MEM_OBJECT_IMAGE2D == imageType) ? mImageDims[0] * imagePixelBytes(mImageFormat) : 0 };
+    if (mImageMem && (key == mImageKey))
+      return error;
 
-    if (isImageParam) {
-      if (!mImageMem) {
-        // create new image object
-        cl_image_format clImageFormat;
-        memset(&clImageFormat, 0, sizeof(clImageFormat));
-        clImageFormat.image_channel_order = CL_RGBA;
-        clImageFormat.image_channel_data_type = CL_FLOAT;
-
-        cl_image_desc clImageDesc;
-        memset(&clImageDesc, 0, sizeof(clImageDesc));
-        clImageDesc.image_type = runParams->numDims() > 2 ? CL_MEM_OBJECT_IMAGE3D : CL_MEM_OBJECT_IMAGE2D;
-        clImageDesc.image_width = mImageDims[0];
-        clImageDesc.image_height = runParams->numDims() > 1 ? mImageDims[1] : 1;
-        clImageDesc.image_depth = runParams->numDims() > 2 ? mImageDims[2] : 1;
-        if (mDevInfo->oclVer >= clVersion(2,0))
-          clImageDesc.mem_object = mPinnedMem;
-
-        cl_mem_flags clMemFlags = (eMemFlags::READONLY == mMemFlags) ? CL_MEM_READ_ONLY :
-                                  (eMemFlags::WRITEONLY == mMemFlags) ? CL_MEM_WRITE_ONLY :
-                                  CL_MEM_READ_WRITE;
-        mImageMem = clCreateImage(mContext, clMemFlags, &clImageFormat, &clImageDesc, nullptr, &error);
+    if (mImageMem) {
+      if (!mImageShared && (eMemLatest::IMAGE == mMemLatest)) {
+        error = copyImageToBuffer(queueNum);
         PASS_CL_ERROR;
+      }
+      mMemLatest = eMemLatest::BUFFER;
+    }
+
+    std::vector<imageView>& views = mAlloc->imageViews;
+    auto viewIter = std::find_if(views.begin(), views.end(), [&key](const imageView& v) { return v.key == key; });
+    if (viewIter != views.end()) {
+      imageView view = *viewIter;
+      views.erase(viewIter);
+      views.push_back(view);
+    } else {
+      cl_image_desc clImageDesc;
+      memset(&clImageDesc, 0, sizeof(clImageDesc));
+      clImageDesc.image_type = imageType;
+      clImageDesc.image_width = key.region[0];
+      clImageDesc.image_height = key.region[1];
+      clImageDesc.image_depth = key.region[2];
+      if (CL_MEM_OBJECT_IMAGE1D_ARRAY == imageType)
+        clImageDesc.image_array_size = key.region[1];
+      else if (CL_MEM_OBJECT_IMAGE2D_ARRAY == imageType)
+        clImageDesc.image_array_size = key.region[2];
+      clImageDesc.image_row_pitch = key.rowPitch;
+      if (shared)
+        clImageDesc.mem_object = mPinnedMem;
+
+      cl_mem_flags clMemFlags = (eMemFlags::READONLY == mMemFlags) ? CL_MEM_READ_ONLY :
+                                (eMemFlags::WRITEONLY == mMemFlags) ? CL_MEM_WRITE_ONLY :
+                                CL_MEM_READ_WRITE;
+      cl_image_format clImageFormat = mImageFormat;
+      cl_mem imageMem = clCreateImage(mContext, clMemFlags, &clImageFormat, &clImageDesc, nullptr, &error);
+      PASS_CL_ERROR;
 
-        kernelMem = &mImageMem;
+      if (views.size() >= maxImageViews) {
+        error = clReleaseMemObject(views.front().imageMem);
+        views.erase(views.begin());
+        PASS_CL_ERROR;
       }
+      views.push_back({ key, imageMem, shared });
+    }
 
-      if (mDevInfo->oclVer < clVersion(2,0)) {
+    mImageMem = views.back().imageMem;
+    mImageShared = views.back().shared;
+    mImageType = imageType;
+    mImageKey = key;
+    return error;
+  }
+
+  // An image created over the buffer memory stays in sync without copies. A 1D buffer image always uses the
+  // buffer memory. A 2D image needs OpenCL 2.0 or cl_khr_image2d_from_buffer and a buffer that meets
+  // the device pitch and base address alignment.
+  bool canShareImage(cl_mem_object_type imageType) const {
+    if (CL_MEM_OBJECT_IMAGE1D_BUFFER == imageType)
+      return true;
+    if (!mDevInfo->imageFromBuffer || (CL_MEM_OBJECT_IMAGE2D != imageType))
+      return false;
+    if (mDevInfo->imagePitchAlign && (mImageDims[0] % mDevInfo->imagePitchAlign))
+      return false;
+    size_t baseAlignBytes = mDevInfo->imageBaseAddrAlign * imagePixelBytes(mImageFormat);
+    if (baseAlignBytes && isSvm() && ((uintptr_t)mHostBuf % baseAlignBytes))
+      return false;
+    return true;
+  }
+
+  cl_int getKernelMem(cl_mem_object_type imageType, iKernelArg::eAccess access,
+                      bool &isSVM, void *&kernelMem, uint32_t queueNum) {
+    kernelMem = mImageMem ? &mImageMem : &mPinnedMem;
+    const size_t origin[3] = { 0, 0, 0 };
+    cl_int error = checkAllocated("kernel use");
+    PASS_CL_ERROR;
+
+    if (imageType) {
+      error = selectImage(imageType, queueNum);
+      PASS_CL_ERROR;
+      kernelMem = &mImageMem;
+
+      if (!mImageShared) {
         if (iKernelArg::eAccess::WRITEONLY == access)
           mMemLatest = eMemLatest::IMAGE;
         else if (eMemLatest::BUFFER == mMemLatest) {
           // printf("Copying image memory from buffer size %dx%d\n", mImageDims[0], mImageDims[1]);
-          size_t region[3] = { 1, 1, 1 };
-          for (size_t i = 0; i < runParams->numDims(); ++i)
-            region[i] = mImageDims[i];
-          error = clEnqueueCopyBufferToImage(getCommandQueue(queueNum), mPinnedMem, mImageMem, 0, origin, region, 0, nullptr, nullptr);
+          std::array<size_t, 3> region = imageRegion(mImageType);
+          error = clEnqueueCopyBufferToImage(getCommandQueue(queueNum), mPinnedMem, mImageMem, 0, origin, region.data(), 0, nullptr, nullptr);
           PASS_CL_ERROR;
+          mMemLatest = eMemLatest::SAME;
+          mDevInfo->imageCopiesToImage++;
+          mDevInfo->imageCopyBytes += region[0] * region[1] * region[2] * imagePixelBytes(mImageFormat);
         }
       }
     } else if (mImageMem) {
       // copy back from image if required, leave image allocation allocated
-      if ((mDevInfo->oclVer < clVersion(2,0)) && (eMemLatest::IMAGE == mMemLatest)) {
+      if (!mImageShared && (eMemLatest::IMAGE == mMemLatest)) {
         error = copyImageToBuffer(queueNum);
         PASS_CL_ERROR;
       }
+      // the kernel may write through the pointer
+      mMemLatest = eMemLatest::BUFFER;
       kernelMem = &mPinnedMem;
     }
 
-    isSVM = (eSvmType::NONE != mSvmType) && !isImageParam;
+    isSVM = isSvm() && !imageType;
     if (isSVM)
       kernelMem = mHostBuf;
 
@@ -341,6 +854,16 @@ private:
 };
 
 iClMemory *iClMemory::create(cl_context context, std::vector<cl_command_queue> commandQueues, eMemFlags memFlags, eSvmType svmType,
-                             uint32_t numBytes, deviceInfo *devInfo, const std::array<uint32_t, 3>& imageDims) {
-  return new clMemory(context, commandQueues, memFlags, svmType, numBytes, devInfo, imageDims);
+                             size_t numBytes, deviceInfo *devInfo, const std::array<uint32_t, 3>& imageDims,
+                             const cl_image_format& imageFormat, std::shared_ptr<iClMemPool> memPool,
+                             std::shared_ptr<iHostCopy> hostCopy, std::shared_ptr<iStagingRing> staging) {
+  return new clMemory(context, commandQueues, memFlags, svmType, numBytes, devInfo, imageDims, imageFormat, memPool, hostCopy,
+                      staging);
+}
+
+iClMemory *iClMemory::wrap(cl_context context, std::vector<cl_command_queue> commandQueues, eMemFlags memFlags, eSvmType svmType,
+                           size_t numBytes, deviceInfo *devInfo, void *hostPtr, std::shared_ptr<iClMemPool> memPool,
+                           std::shared_ptr<iHostCopy> hostCopy) {
+  return new clMemory(context, commandQueues, memFlags, svmType, numBytes, devInfo, {{0, 0, 0}}, { CL_RGBA, CL_FLOAT },
+                      memPool, hostCopy, nullptr, hostPtr);
 }
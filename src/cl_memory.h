@@ -29,16 +29,24 @@
 #include "run_params.h"
 
 class iRunParams;
+class iClMemPool;
+class iHostCopy;
+class iStagingRing;
 struct deviceInfo;
 
 enum class eMemFlags : uint8_t { NONE = 0, READWRITE = 1, WRITEONLY = 2, READONLY = 3 };
-enum class eSvmType : uint8_t { NONE = 0, COARSE = 1, FINE = 2 };
+// A staged buffer is device-only memory with a separate host copy, moved through the pinned staging ring
+enum class eSvmType : uint8_t { NONE = 0, COARSE = 1, FINE = 2, STAGED = 3 };
+
+// Bytes per pixel for an image format, zero if the format is not recognised
+size_t imagePixelBytes(const cl_image_format& imageFormat);
 
 class iGpuMemory {
 public:
   virtual ~iGpuMemory() {}
-  virtual cl_int setKernelParam(cl_kernel kernel, uint32_t paramIndex, bool isImageParam,
-                                iKernelArg::eAccess access, iRunParams *runParams, uint32_t queueNum) = 0;
+  // imageType is the OpenCL image object type for an image parameter, 0 for a buffer parameter
+  virtual cl_int setKernelParam(cl_kernel kernel, uint32_t paramIndex, cl_mem_object_type imageType,
+                                iKernelArg::eAccess access, uint32_t queueNum) = 0;
 };
 
 class iClMemory {
@@ -46,20 +54,51 @@ public:
   virtual ~iClMemory() {}
 
   static iClMemory *create(cl_context context, std::vector<cl_command_queue> commandQueues, eMemFlags memFlags, eSvmType svmType, 
-                           uint32_t numBytes, deviceInfo *devInfo, const std::array<uint32_t, 3>& imageDims);
+                           size_t numBytes, deviceInfo *devInfo, const std::array<uint32_t, 3>& imageDims,
+                           const cl_image_format& imageFormat, std::shared_ptr<iClMemPool> memPool,
+                           std::shared_ptr<iHostCopy> hostCopy, std::shared_ptr<iStagingRing> staging);
+  // Uses existing host memory of numBytes at hostPtr for the OpenCL memory, without a copy. When isWrapped() is
+  // true after allocate(), the caller must keep the host memory alive until the callback set with setWrapRelease
+  // is called. An SVM type of fine is for system SVM devices.
+  static iClMemory *wrap(cl_context context, std::vector<cl_command_queue> commandQueues, eMemFlags memFlags, eSvmType svmType,
+                         size_t numBytes, deviceInfo *devInfo, void *hostPtr, std::shared_ptr<iClMemPool> memPool,
+                         std::shared_ptr<iHostCopy> hostCopy);
 
   virtual bool allocate() = 0;
   virtual std::shared_ptr<iGpuMemory> getGPUMemory() = 0;
-  virtual cl_int setHostAccess(eMemFlags haFlags, uint32_t queueNum) = 0;
-  virtual cl_int copyFrom(const void *srcBuf, size_t numBytes, uint32_t queueNum) = 0;
+  // Maps numBytes from offset for host access, unmapping any other mapped region first. Without overlapping
+  // queues, blocking waits for the map to complete - otherwise the caller must finish the queue before host access.
+  virtual cl_int setHostAccess(eMemFlags haFlags, uint32_t queueNum, size_t offset, size_t numBytes, bool blocking) = 0;
+  // Without overlapping queues, gives an event that completes when host access set without blocking is ready,
+  // for the caller to wait on and release. With overlapping queues there is nothing to wait for and it gives nullptr.
+  virtual cl_int hostAccessEvent(uint32_t queueNum, cl_event *event) = 0;
+  virtual cl_int copyFrom(const void *srcBuf, size_t numBytes) = 0;
+  // Device-side copies to another buffer, enqueued on queueNum without mapping either buffer to the host
+  virtual cl_int copyTo(iClMemory *dst, size_t srcOffset, size_t dstOffset, size_t numBytes, uint32_t queueNum) = 0;
+  virtual cl_int copyRectTo(iClMemory *dst, const std::array<size_t, 3>& srcOrigin, const std::array<size_t, 3>& dstOrigin,
+                            const std::array<size_t, 3>& region, size_t srcRowPitch, size_t srcSlicePitch,
+                            size_t dstRowPitch, size_t dstSlicePitch, uint32_t queueNum) = 0;
+  // Device-side fills, blocking unless overlapping queues are in use. fillImage takes a four component
+  // float, int or uint colour according to the image data type.
+  virtual cl_int fill(const void *pattern, size_t patternBytes, size_t offset, size_t size, uint32_t queueNum) = 0;
+  virtual cl_int fillImage(const void *fillColour, uint32_t queueNum) = 0;
+  // Enqueues a migration of the memory to the device, or to the host when toHost is set, ahead of its next use.
+  // Blocking unless overlapping queues are in use. A no-op for persistently mapped unified memory.
+  virtual cl_int migrate(bool toHost, uint32_t queueNum) = 0;
+  // Hands the memory back without waiting for queued work that may use it, which the pool waits for instead
   virtual void freeAllocation() = 0;
+  // For wrapped memory, released is called with releasedData from a background thread once the OpenCL buffer
+  // has been released after the work queued before freeAllocation, so that the host memory can then be freed
+  virtual void setWrapRelease(void (*released)(void *), void *releasedData) = 0;
 
-  virtual uint32_t numBytes() const = 0;
+  virtual size_t numBytes() const = 0;
   virtual eMemFlags memFlags() const = 0;
   virtual eSvmType svmType() const = 0;
   virtual std::string svmTypeName() const = 0;
   virtual void* hostBuf() const = 0;
+  virtual bool isWrapped() const = 0;
   virtual bool hasDimensions() const = 0;
+  virtual const cl_image_format& imageFormat() const = 0;
 };
 
 #endif
@@ -0,0 +1,178 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "cl_staging.h"
+#include "noden_util.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+struct stagingSlot {
+  cl_mem pinnedMem = nullptr;
+  void *hostBuf = nullptr;
+  cl_event lastUse = nullptr; // the transfer that must complete before the slot is reused
+};
+
+class stagingRing : public iStagingRing {
+public:
+  stagingRing(cl_context context, uint32_t numSlots, size_t chunkBytes)
+    : mContext(context), mNumSlots(numSlots > 1 ? numSlots : 2),
+      mChunkBytes(chunkBytes < 4096 ? 4096 : chunkBytes & ~(size_t)63), mMapQueue(nullptr), mNextSlot(0) {
+    clRetainContext(mContext);
+  }
+  ~stagingRing() {
+    releaseSlots();
+    clReleaseContext(mContext);
+  }
+
+  cl_int upload(cl_command_queue commandQueue, cl_mem dst, size_t dstOffset, const void *src,
+                size_t numBytes, bool blocking) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    cl_int error = createSlots(commandQueue);
+    PASS_CL_ERROR;
+
+    for (size_t offset = 0; offset < numBytes; offset += mChunkBytes) {
+      size_t bytes = std::min(mChunkBytes, numBytes - offset);
+      stagingSlot& slot = mSlots[mNextSlot];
+      mNextSlot = (mNextSlot + 1) % mNumSlots;
+      error = waitSlot(slot);
+      PASS_CL_ERROR;
+
+      memcpy(slot.hostBuf, (const uint8_t *)src + offset, bytes);
+      error = clEnqueueWriteBuffer(commandQueue, dst, CL_NON_BLOCKING, dstOffset + offset, bytes, slot.hostBuf,
+                                   0, nullptr, &slot.lastUse);
+      PASS_CL_ERROR;
+      // start the transfer while the next chunk is copied
+      error = clFlush(commandQueue);
+      PASS_CL_ERROR;
+    }
+
+    if (blocking) {
+      for (auto& slot: mSlots) {
+        error = waitSlot(slot);
+        PASS_CL_ERROR;
+      }
+    }
+    return error;
+  }
+
+  cl_int download(cl_command_queue commandQueue, cl_mem src, size_t srcOffset, void *dst, size_t numBytes) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    cl_int error = createSlots(commandQueue);
+    PASS_CL_ERROR;
+
+    // keep a read in flight in every slot, copying each chunk out in order as its read completes
+    size_t numChunks = (numBytes + mChunkBytes - 1) / mChunkBytes;
+    uint32_t firstSlot = mNextSlot;
+    for (size_t chunk = 0; (chunk < numChunks) && (chunk < mNumSlots); ++chunk) {
+      error = enqueueRead(commandQueue, src, srcOffset, numBytes, chunk, mSlots[(firstSlot + chunk) % mNumSlots]);
+      PASS_CL_ERROR;
+    }
+    error = clFlush(commandQueue);
+    PASS_CL_ERROR;
+
+    for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+      stagingSlot& slot = mSlots[(firstSlot + chunk) % mNumSlots];
+      error = waitSlot(slot);
+      PASS_CL_ERROR;
+
+      size_t offset = chunk * mChunkBytes;
+      memcpy((uint8_t *)dst + offset, slot.hostBuf, std::min(mChunkBytes, numBytes - offset));
+      if (chunk + mNumSlots < numChunks) {
+        error = enqueueRead(commandQueue, src, srcOffset, numBytes, chunk + mNumSlots, slot);
+        PASS_CL_ERROR;
+        error = clFlush(commandQueue);
+        PASS_CL_ERROR;
+      }
+    }
+    mNextSlot = (uint32_t)((firstSlot + numChunks) % mNumSlots);
+    return error;
+  }
+
+  size_t chunkBytes() const { return mChunkBytes; }
+
+private:
+  cl_context mContext;
+  const uint32_t mNumSlots;
+  const size_t mChunkBytes;
+  std::vector<stagingSlot> mSlots;
+  cl_command_queue mMapQueue; // the slots stay mapped on the queue first used with the ring
+  uint32_t mNextSlot;
+  std::mutex mMutex;
+
+  // Pinned host memory comes from mapping a buffer allocated with CL_MEM_ALLOC_HOST_PTR
+  cl_int createSlots(cl_command_queue commandQueue) {
+    cl_int error = CL_SUCCESS;
+    if (!mSlots.empty())
+      return error;
+
+    mMapQueue = commandQueue;
+    clRetainCommandQueue(mMapQueue);
+    mSlots.resize(mNumSlots);
+    for (auto& slot: mSlots) {
+      slot.pinnedMem = clCreateBuffer(mContext, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, mChunkBytes, nullptr, &error);
+      if (CL_SUCCESS == error)
+        slot.hostBuf = clEnqueueMapBuffer(mMapQueue, slot.pinnedMem, CL_BLOCKING, CL_MAP_READ | CL_MAP_WRITE,
+                                          0, mChunkBytes, 0, nullptr, nullptr, &error);
+      if (CL_SUCCESS != error) {
+        releaseSlots(); // try again on next use
+        return error;
+      }
+    }
+    return error;
+  }
+
+  void releaseSlots() {
+    for (auto& slot: mSlots) {
+      waitSlot(slot);
+      if (slot.hostBuf)
+        clEnqueueUnmapMemObject(mMapQueue, slot.pinnedMem, slot.hostBuf, 0, nullptr, nullptr);
+    }
+    if (mMapQueue) {
+      clFinish(mMapQueue);
+      clReleaseCommandQueue(mMapQueue);
+      mMapQueue = nullptr;
+    }
+    for (auto& slot: mSlots)
+      if (slot.pinnedMem)
+        clReleaseMemObject(slot.pinnedMem);
+    mSlots.clear();
+    mNextSlot = 0;
+  }
+
+  cl_int waitSlot(stagingSlot& slot) {
+    cl_int error = CL_SUCCESS;
+    if (slot.lastUse) {
+      error = clWaitForEvents(1, &slot.lastUse);
+      clReleaseEvent(slot.lastUse);
+      slot.lastUse = nullptr;
+    }
+    return error;
+  }
+
+  cl_int enqueueRead(cl_command_queue commandQueue, cl_mem src, size_t srcOffset, size_t numBytes,
+                     size_t chunk, stagingSlot& slot) {
+    cl_int error = waitSlot(slot);
+    PASS_CL_ERROR;
+    size_t offset = chunk * mChunkBytes;
+    return clEnqueueReadBuffer(commandQueue, src, CL_NON_BLOCKING, srcOffset + offset,
+                               std::min(mChunkBytes, numBytes - offset), slot.hostBuf, 0, nullptr, &slot.lastUse);
+  }
+};
+
+std::shared_ptr<iStagingRing> iStagingRing::create(cl_context context, uint32_t numSlots, size_t chunkBytes) {
+  return std::make_shared<stagingRing>(context, numSlots, chunkBytes);
+}
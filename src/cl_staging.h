@@ -0,0 +1,47 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef CL_STAGING_H
+#define CL_STAGING_H
+
+#ifdef __APPLE__
+    #include "OpenCL/opencl.h"
+#else
+    #include "CL/cl.h"
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+
+// Ring of pinned host buffers used to move data between ordinary host memory and device-only buffers in
+// chunks, so that the host copy into or out of one chunk overlaps the device transfer of the next
+class iStagingRing {
+public:
+  virtual ~iStagingRing() {}
+
+  // The pinned buffers of chunkBytes each are created on first use
+  static std::shared_ptr<iStagingRing> create(cl_context context, uint32_t numSlots, size_t chunkBytes);
+
+  // Enqueues writes of numBytes from src to dst at dstOffset. The source can be reused on return. With blocking,
+  // waits for the writes to complete - otherwise they only complete in order with later work on the queue.
+  virtual cl_int upload(cl_command_queue commandQueue, cl_mem dst, size_t dstOffset, const void *src,
+                        size_t numBytes, bool blocking) = 0;
+  // Reads numBytes from src at srcOffset into dst, blocking until the data is in dst
+  virtual cl_int download(cl_command_queue commandQueue, cl_mem src, size_t srcOffset, void *dst, size_t numBytes) = 0;
+
+  virtual size_t chunkBytes() const = 0;
+};
+
+#endif
@@ -0,0 +1,136 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "cl_svm_select.h"
+#include "cl_mem_pool.h"
+#include "noden_context.h"
+#include "noden_util.h"
+#include <climits>
+#include <cstring>
+#include <vector>
+
+static const char *touchKernelSource =
+  "__kernel void touch(__global uint4 *buf) {\n"
+  "  size_t i = get_global_id(0);\n"
+  "  buf[i] += (uint4)(1);\n"
+  "}\n";
+
+// Best time in microseconds of a few rounds of host write, kernel and host read, or LLONG_MAX on failure
+long long measureSvmType(cl_context context, cl_command_queue commandQueue, cl_kernel kernel, deviceInfo *devInfo,
+                         eSvmType svmType, size_t numBytes, std::shared_ptr<iClMemPool> memPool,
+                         std::shared_ptr<iHostCopy> hostCopy, std::shared_ptr<iStagingRing> staging) {
+  const int numRounds = 4; // the first round is a warm up
+  long long bestTime = LLONG_MAX;
+  iClMemory *clMem = iClMemory::create(context, { commandQueue }, eMemFlags::READWRITE, svmType, numBytes, devInfo,
+                                       {{0, 0, 0}}, { CL_RGBA, CL_FLOAT }, memPool, hostCopy, staging);
+  if (!clMem->allocate()) {
+    delete clMem;
+    return bestTime;
+  }
+
+  size_t globalWorkItems = numBytes / 16;
+  for (int r = 0; r < numRounds; ++r) {
+    HR_TIME_POINT start = NOW;
+    cl_int error = clMem->setHostAccess(eMemFlags::WRITEONLY, 0, 0, numBytes, true);
+    if (CL_SUCCESS != error)
+      break;
+    memset(clMem->hostBuf(), r, numBytes);
+
+    {
+      std::shared_ptr<iGpuMemory> gpuMem = clMem->getGPUMemory();
+      error = gpuMem->setKernelParam(kernel, 0, 0, iKernelArg::eAccess::NONE, 0);
+    }
+    if (CL_SUCCESS == error)
+      error = clEnqueueNDRangeKernel(commandQueue, kernel, 1, nullptr, &globalWorkItems, nullptr, 0, nullptr, nullptr);
+    if (CL_SUCCESS == error)
+      error = clFinish(commandQueue);
+    if (CL_SUCCESS == error)
+      error = clMem->setHostAccess(eMemFlags::READONLY, 0, 0, numBytes, true);
+    if (CL_SUCCESS != error)
+      break;
+
+    // read a word from every page, as a consumer of the result would
+    volatile uint32_t sum = 0;
+    const uint8_t *hostBuf = (const uint8_t *)clMem->hostBuf();
+    for (size_t offset = 0; offset + 4 <= numBytes; offset += 4096)
+      sum += *(const uint32_t *)(hostBuf + offset);
+
+    long long roundTime = microTime(start);
+    if ((r > 0) && (roundTime < bestTime))
+      bestTime = roundTime;
+  }
+
+  delete clMem;
+  return bestTime;
+}
+
+eSvmType selectSvmType(cl_context context, cl_command_queue commandQueue, deviceInfo *devInfo, cl_ulong svmCaps,
+                       size_t numBytes, std::shared_ptr<iClMemPool> memPool, std::shared_ptr<iHostCopy> hostCopy,
+                       std::shared_ptr<iStagingRing> staging) {
+  // concurrent requests for the same size class wait for one measurement
+  std::lock_guard<std::mutex> lk(devInfo->autoSvmMutex);
+  size_t sizeClass = allocSizeClass(numBytes);
+  auto typeIter = devInfo->autoSvmTypes.find(sizeClass);
+  if (typeIter != devInfo->autoSvmTypes.end())
+    return typeIter->second;
+
+  eSvmType bestType = eSvmType::NONE;
+  if (sizeClass >= 4096) {
+    std::vector<eSvmType> svmTypes = { eSvmType::NONE, eSvmType::STAGED };
+    if (svmCaps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER)
+      svmTypes.push_back(eSvmType::COARSE);
+    if (svmCaps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER)
+      svmTypes.push_back(eSvmType::FINE);
+
+    cl_int error = CL_SUCCESS;
+    cl_program program = clCreateProgramWithSource(context, 1, &touchKernelSource, nullptr, &error);
+    if (CL_SUCCESS == error)
+      error = clBuildProgram(program, 0, nullptr, "", nullptr, nullptr);
+    cl_kernel kernel = nullptr;
+    if (CL_SUCCESS == error)
+      kernel = clCreateKernel(program, "touch", &error);
+
+    if (CL_SUCCESS == error) {
+      long long bestTime = LLONG_MAX;
+      for (auto svmType: svmTypes) {
+        long long svmTime = measureSvmType(context, commandQueue, kernel, devInfo, svmType, sizeClass,
+                                           memPool, hostCopy, staging);
+        if (svmTime < bestTime) {
+          bestTime = svmTime;
+          bestType = svmType;
+        }
+      }
+    } else
+      printf("OpenCL error in subroutine. Location %s(%d). Error %i: %s\n",
+        __FILE__, __LINE__, error, clGetErrorString(error));
+
+    if (kernel)
+      clReleaseKernel(kernel);
+    if (program)
+      clReleaseProgram(program);
+  }
+
+  devInfo->autoSvmTypes[sizeClass] = bestType;
+  return bestType;
+}
+
+bool cachedSvmType(deviceInfo *devInfo, size_t numBytes, eSvmType& svmType) {
+  std::lock_guard<std::mutex> lk(devInfo->autoSvmMutex);
+  auto typeIter = devInfo->autoSvmTypes.find(allocSizeClass(numBytes));
+  if (typeIter == devInfo->autoSvmTypes.end())
+    return false;
+  svmType = typeIter->second;
+  return true;
+}
@@ -0,0 +1,37 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef CL_SVM_SELECT_H
+#define CL_SVM_SELECT_H
+
+#ifdef __APPLE__
+    #include "OpenCL/opencl.h"
+#else
+    #include "CL/cl.h"
+#endif
+#include <memory>
+#include "cl_memory.h"
+
+// Buffer type with the lowest measured cost of a host write, a kernel pass over the buffer and a host read
+// for buffers of the size class of numBytes, trying each type supported according to svmCaps. The result is
+// cached in devInfo, so only the first request for each size class runs the measurement. Blocks while measuring.
+eSvmType selectSvmType(cl_context context, cl_command_queue commandQueue, deviceInfo *devInfo, cl_ulong svmCaps,
+                       size_t numBytes, std::shared_ptr<iClMemPool> memPool, std::shared_ptr<iHostCopy> hostCopy,
+                       std::shared_ptr<iStagingRing> staging);
+
+// Previously measured type for the size class of numBytes, returning false if it has not been measured
+bool cachedSvmType(deviceInfo *devInfo, size_t numBytes, eSvmType& svmType);
+
+#endif
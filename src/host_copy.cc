@@ -0,0 +1,179 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "host_copy.h"
+#include <algorithm>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define HOST_COPY_STREAM
+#endif
+
+// Copy with non-temporal stores where available so that large frames do not evict the cache
+void streamCopy(uint8_t *dst, const uint8_t *src, size_t numBytes) {
+#ifdef HOST_COPY_STREAM
+  size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+  if (head > numBytes)
+    head = numBytes;
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  numBytes -= head;
+
+  size_t numBlocks = numBytes / 64;
+  for (size_t b = 0; b < numBlocks; ++b) {
+    __m128i v0 = _mm_loadu_si128((const __m128i *)(src + 0));
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(src + 16));
+    __m128i v2 = _mm_loadu_si128((const __m128i *)(src + 32));
+    __m128i v3 = _mm_loadu_si128((const __m128i *)(src + 48));
+    _mm_stream_si128((__m128i *)(dst + 0), v0);
+    _mm_stream_si128((__m128i *)(dst + 16), v1);
+    _mm_stream_si128((__m128i *)(dst + 32), v2);
+    _mm_stream_si128((__m128i *)(dst + 48), v3);
+    src += 64;
+    dst += 64;
+  }
+  memcpy(dst, src, numBytes - numBlocks * 64);
+  _mm_sfence();
+#else
+  memcpy(dst, src, numBytes);
+#endif
+}
+
+class hostCopy : public iHostCopy {
+public:
+  hostCopy(uint32_t numThreads, size_t minParallelBytes, size_t chunkBytes)
+    : mNumThreads(numThreads > 0 ? numThreads : 1), mMinParallelBytes(minParallelBytes),
+      mChunkBytes(chunkBytes < 4096 ? 4096 : chunkBytes & ~(size_t)63),
+      mQuit(false), mActiveWorkers(0), mJob(), mNextChunk(0), mChunksDone(0) {
+    for (uint32_t i = 1; i < mNumThreads; ++i)
+      mWorkers.push_back(std::thread(&hostCopy::workerLoop, this));
+  }
+  ~hostCopy() {
+    {
+      std::lock_guard<std::mutex> lk(mMutex);
+      mQuit = true;
+    }
+    mWorkCv.notify_all();
+    for (auto& w: mWorkers)
+      w.join();
+  }
+
+  void copy(void *dst, const void *src, size_t numBytes) {
+    if ((numBytes < mMinParallelBytes) || mWorkers.empty()) {
+      memcpy(dst, src, numBytes);
+      return;
+    }
+
+    std::lock_guard<std::mutex> copyLk(mCopyMutex);
+    copyJob job;
+    {
+      std::lock_guard<std::mutex> lk(mMutex);
+      job.generation = mJob.generation + 1;
+      job.dst = (uint8_t *)dst;
+      job.src = (const uint8_t *)src;
+      job.numBytes = numBytes;
+      job.numChunks = (numBytes + mChunkBytes - 1) / mChunkBytes;
+      mJob = job;
+      mNextChunk = 0;
+      mChunksDone = 0;
+    }
+    mWorkCv.notify_all();
+
+    runChunks(job);
+
+    // wait for the workers to leave the job before the buffers can be reused
+    std::unique_lock<std::mutex> lk(mMutex);
+    mDoneCv.wait(lk, [&]{ return (mChunksDone == job.numChunks) && (0 == mActiveWorkers); });
+  }
+
+  uint32_t numThreads() const { return mNumThreads; }
+
+private:
+  const uint32_t mNumThreads;
+  const size_t mMinParallelBytes;
+  const size_t mChunkBytes;
+  std::vector<std::thread> mWorkers;
+  std::mutex mCopyMutex;
+  std::mutex mMutex;
+  std::condition_variable mWorkCv;
+  std::condition_variable mDoneCv;
+  bool mQuit;
+  uint32_t mActiveWorkers;
+
+  struct copyJob {
+    uint64_t generation = 0;
+    uint8_t *dst = nullptr;
+    const uint8_t *src = nullptr;
+    size_t numBytes = 0;
+    size_t numChunks = 0;
+  };
+  // the current job and its progress, only accessed with mMutex held
+  copyJob mJob;
+  size_t mNextChunk;
+  size_t mChunksDone;
+
+  // A worker can take its copy of the job after that job has completed and copy() has returned, so a chunk is
+  // only claimed while the job is still current
+  bool claimChunk(const copyJob& job, size_t& chunk) {
+    std::lock_guard<std::mutex> lk(mMutex);
+    if ((job.generation != mJob.generation) || (mNextChunk >= job.numChunks))
+      return false;
+    chunk = mNextChunk++;
+    return true;
+  }
+
+  void runChunks(const copyJob& job) {
+    size_t chunk;
+    while (claimChunk(job, chunk)) {
+      size_t offset = chunk * mChunkBytes;
+      size_t bytes = std::min(mChunkBytes, job.numBytes - offset);
+      streamCopy(job.dst + offset, job.src + offset, bytes);
+      std::lock_guard<std::mutex> lk(mMutex);
+      if (++mChunksDone == job.numChunks)
+        mDoneCv.notify_all();
+    }
+  }
+
+  void workerLoop() {
+    uint64_t generation = 0;
+    while (true) {
+      copyJob job;
+      {
+        std::unique_lock<std::mutex> lk(mMutex);
+        mWorkCv.wait(lk, [&]{ return mQuit || (generation != mJob.generation); });
+        if (mQuit)
+          return;
+        job = mJob;
+        generation = job.generation;
+        ++mActiveWorkers;
+      }
+
+      runChunks(job);
+
+      std::lock_guard<std::mutex> lk(mMutex);
+      --mActiveWorkers;
+      mDoneCv.notify_all();
+    }
+  }
+};
+
+std::shared_ptr<iHostCopy> iHostCopy::create(uint32_t numThreads, size_t minParallelBytes, size_t chunkBytes) {
+  return std::make_shared<hostCopy>(numThreads, minParallelBytes, chunkBytes);
+}
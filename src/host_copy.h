@@ -0,0 +1,38 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HOST_COPY_H
+#define HOST_COPY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+
+// Persistent threads used to copy large source buffers into OpenCL host memory
+class iHostCopy {
+public:
+  virtual ~iHostCopy() {}
+
+  // Copies of at least minParallelBytes are split into chunks of chunkBytes shared between numThreads
+  // threads, including the caller. Smaller copies are a single memcpy on the calling thread.
+  static std::shared_ptr<iHostCopy> create(uint32_t numThreads, size_t minParallelBytes, size_t chunkBytes);
+
+  // Blocks until the copy is complete. Concurrent calls are serialised.
+  virtual void copy(void *dst, const void *src, size_t numBytes) = 0;
+
+  virtual uint32_t numThreads() const = 0;
+};
+
+#endif
@@ -16,37 +16,179 @@
 #include "noden_buffer.h"
 #include "noden_util.h"
 #include "cl_memory.h"
+#include "cl_mem_pool.h"
+#include "host_copy.h"
+#include "cl_staging.h"
+#include "cl_svm_select.h"
+#include "noden_context.h"
 #include <cstring>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <functional>
 
-struct deviceInfo;
+struct imageFormatName {
+  const char* name;
+  cl_uint value;
+};
+
+const imageFormatName channelOrderNames[] = {
+  { "R", CL_R }, { "A", CL_A }, { "RG", CL_RG }, { "RA", CL_RA }, { "RGB", CL_RGB },
+  { "RGBA", CL_RGBA }, { "BGRA", CL_BGRA }, { "ARGB", CL_ARGB }, { "ABGR", CL_ABGR },
+  { "INTENSITY", CL_INTENSITY }, { "LUMINANCE", CL_LUMINANCE }, { "Rx", CL_Rx },
+  { "RGx", CL_RGx }, { "RGBx", CL_RGBx }, { "sRGB", CL_sRGB }, { "sRGBx", CL_sRGBx },
+  { "sRGBA", CL_sRGBA }, { "sBGRA", CL_sBGRA }
+};
+
+const imageFormatName dataTypeNames[] = {
+  { "SNORM_INT8", CL_SNORM_INT8 }, { "SNORM_INT16", CL_SNORM_INT16 },
+  { "UNORM_INT8", CL_UNORM_INT8 }, { "UNORM_INT16", CL_UNORM_INT16 },
+  { "UNORM_SHORT_565", CL_UNORM_SHORT_565 }, { "UNORM_SHORT_555", CL_UNORM_SHORT_555 },
+  { "UNORM_INT_101010", CL_UNORM_INT_101010 },
+  { "SIGNED_INT8", CL_SIGNED_INT8 }, { "SIGNED_INT16", CL_SIGNED_INT16 }, { "SIGNED_INT32", CL_SIGNED_INT32 },
+  { "UNSIGNED_INT8", CL_UNSIGNED_INT8 }, { "UNSIGNED_INT16", CL_UNSIGNED_INT16 }, { "UNSIGNED_INT32", CL_UNSIGNED_INT32 },
+  { "HALF_FLOAT", CL_HALF_FLOAT }, { "FLOAT", CL_FLOAT }
+};
+
+bool lookupFormatName(const imageFormatName* names, size_t numNames, const char* name, cl_uint& value) {
+  for (size_t i = 0; i < numNames; ++i) {
+    if (0 == strcmp(names[i].name, name)) {
+      value = names[i].value;
+      return true;
+    }
+  }
+  return false;
+}
+
+cl_int checkImageFormat(cl_context context, deviceInfo *devInfo, cl_mem_flags memFlags, cl_mem_object_type imageType,
+                        const cl_image_format& imageFormat, bool& supported) {
+  cl_int error = CL_SUCCESS;
+  auto formatsKey = std::make_pair((uint64_t)memFlags, (uint32_t)imageType);
+  auto formatsIter = devInfo->imageFormats.find(formatsKey);
+  if (formatsIter == devInfo->imageFormats.end()) {
+    cl_uint numFormats = 0;
+    error = clGetSupportedImageFormats(context, memFlags, imageType, 0, nullptr, &numFormats);
+    PASS_CL_ERROR;
+    std::vector<cl_image_format> formats(numFormats);
+    if (numFormats > 0) {
+      error = clGetSupportedImageFormats(context, memFlags, imageType, numFormats, formats.data(), nullptr);
+      PASS_CL_ERROR;
+    }
+    formatsIter = devInfo->imageFormats.emplace(formatsKey, formats).first;
+  }
+
+  supported = false;
+  for (auto& format: formatsIter->second) {
+    if ((format.image_channel_order == imageFormat.image_channel_order) &&
+        (format.image_channel_data_type == imageFormat.image_channel_data_type)) {
+      supported = true;
+      break;
+    }
+  }
+  return error;
+}
 
 struct createBufCarrier : carrier {
   napi_ref contextRef = nullptr;
   iClMemory *clMem = nullptr;
   uint32_t numQueues = 1;
+  // source memory for wrapBuffer, held by passthru - copied in when it cannot be wrapped
+  void *srcBuf = nullptr;
+  size_t srcBufSize = 0;
+  // for bufType 'auto' the type is measured and the memory created on the worker thread
+  std::function<iClMemory *()> createMem;
 };
 
+napi_status getOptionalSize(napi_env env, napi_value options, const char* name, size_t& value, bool& valid) {
+  napi_status status;
+  bool hasProp;
+  status = napi_has_named_property(env, options, name, &hasProp);
+  PASS_STATUS;
+  if (!hasProp)
+    return status;
+  napi_value propValue;
+  status = napi_get_named_property(env, options, name, &propValue);
+  PASS_STATUS;
+  int64_t checkValue;
+  status = napi_get_value_int64(env, propValue, &checkValue);
+  PASS_STATUS;
+  valid = valid && (checkValue >= 0);
+  value = (size_t)checkValue;
+  return status;
+}
+
+napi_status getOptionalSize3(napi_env env, napi_value options, const char* name, std::array<size_t, 3>& value, bool& valid) {
+  napi_status status;
+  bool hasProp;
+  status = napi_has_named_property(env, options, name, &hasProp);
+  PASS_STATUS;
+  if (!hasProp)
+    return status;
+  napi_value arrayValue;
+  status = napi_get_named_property(env, options, name, &arrayValue);
+  PASS_STATUS;
+  uint32_t arrayLength;
+  status = napi_get_array_length(env, arrayValue, &arrayLength);
+  PASS_STATUS;
+  valid = valid && (arrayLength > 0) && (arrayLength <= 3);
+  for (uint32_t i = 0; i < arrayLength && i < 3; ++i) {
+    napi_value element;
+    status = napi_get_element(env, arrayValue, i, &element);
+    PASS_STATUS;
+    int64_t checkValue;
+    status = napi_get_value_int64(env, element, &checkValue);
+    PASS_STATUS;
+    valid = valid && (checkValue >= 0);
+    value[i] = (size_t)checkValue;
+  }
+  return status;
+}
+
 struct hostAccessCarrier : carrier {
   iClMemory *clMem = nullptr;
   eMemFlags haFlags = eMemFlags::READWRITE;
   uint32_t queueNum = 0;
   void* srcBuf = nullptr;
   size_t srcBufSize = 0;
+  long long copyTime = 0;
+  // a region resolves to a Buffer view of just the mapped range, with passthru holding the whole buffer
+  bool hasRegion = false;
+  size_t offset = 0;
+  size_t length = 0;
+  bool copyQueued = false;
 };
 
+void hostAccessCopyExecute(napi_env env, void* data) {
+  hostAccessCarrier* c = (hostAccessCarrier*) data;
+  cl_int error;
+
+  HR_TIME_POINT copyStart = NOW;
+  error = c->clMem->copyFrom(c->srcBuf, c->srcBufSize);
+  ASYNC_CL_ERROR;
+  c->copyTime = microTime(copyStart);
+  c->totalTime += c->copyTime;
+}
+
 void hostAccessExecute(napi_env env, void* data) {
   hostAccessCarrier* c = (hostAccessCarrier*) data;
   cl_int error;
 
-  error = c->clMem->setHostAccess(c->haFlags, c->queueNum);
+  HR_TIME_POINT start = NOW;
+
+  // the map is not waited for here - when there is an event to wait for, the promise settles from its completion
+  // and any source copy follows as a further stage
+  error = c->clMem->setHostAccess(c->haFlags, c->queueNum, c->offset, c->length, false);
+  ASYNC_CL_ERROR;
+  cl_event ready;
+  error = c->clMem->hostAccessEvent(c->queueNum, &ready);
   ASYNC_CL_ERROR;
+  c->totalTime = microTime(start);
 
-  if (c->srcBuf) {
-    error = c->clMem->copyFrom(c->srcBuf, c->srcBufSize, c->queueNum);
-    ASYNC_CL_ERROR;
-  }
+  if (ready) {
+    c->completeEvents.push_back(ready);
+    c->waitStart = NOW;
+  } else if (c->srcBuf)
+    hostAccessCopyExecute(env, data);
 }
 
 void hostAccessComplete(napi_env env, napi_status asyncStatus, void* data) {
@@ -55,10 +197,68 @@ void hostAccessComplete(napi_env env, napi_status asyncStatus, void* data) {
     c->status = asyncStatus;
     c->errorMsg = "Async buffer creation failed to complete.";
   }
+  if (deferComplete(env, c, hostAccessComplete)) return;
   REJECT_STATUS;
 
+  if (c->eventsComplete && !c->copyQueued) {
+    c->totalTime += c->waitTime;
+    if (c->srcBuf) {
+      c->copyQueued = true;
+      c->status = queueNextStage(env, c, "HostAccessCopy", hostAccessCopyExecute, hostAccessComplete);
+      REJECT_STATUS;
+      return;
+    }
+  }
+
   napi_value result;
-  c->status = napi_get_undefined(env, &result);
+  if (c->hasRegion) {
+    napi_value bufferValue, subarrayValue, subarrayArgs[2];
+    c->status = napi_get_reference_value(env, c->passthru, &bufferValue);
+    REJECT_STATUS;
+    c->status = napi_get_named_property(env, bufferValue, "subarray", &subarrayValue);
+    REJECT_STATUS;
+    c->status = napi_create_int64(env, (int64_t)c->offset, &subarrayArgs[0]);
+    REJECT_STATUS;
+    c->status = napi_create_int64(env, (int64_t)(c->offset + c->length), &subarrayArgs[1]);
+    REJECT_STATUS;
+    c->status = napi_call_function(env, bufferValue, subarrayValue, 2, subarrayArgs, &result);
+    REJECT_STATUS;
+
+    napi_status status;
+    status = napi_resolve_deferred(env, c->_deferred, result);
+    FLOATING_STATUS;
+
+    tidyCarrier(env, c);
+    return;
+  }
+
+  c->status = napi_create_object(env, &result);
+  REJECT_STATUS;
+
+  napi_value totalValue;
+  c->status = napi_create_int64(env, (int64_t) c->totalTime, &totalValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "totalTime", totalValue);
+  REJECT_STATUS;
+
+  napi_value copyBytesValue;
+  c->status = napi_create_int64(env, c->srcBuf ? (int64_t) c->srcBufSize : 0, &copyBytesValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyBytes", copyBytesValue);
+  REJECT_STATUS;
+
+  napi_value copyTimeValue;
+  c->status = napi_create_int64(env, (int64_t) c->copyTime, &copyTimeValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyTime", copyTimeValue);
+  REJECT_STATUS;
+
+  // bytes per microsecond / 1000 gives GB/s
+  double copyGBps = (c->srcBuf && c->copyTime > 0) ? (double)c->srcBufSize / c->copyTime / 1000.0 : 0.0;
+  napi_value copyGBpsValue;
+  c->status = napi_create_double(env, copyGBps, &copyGBpsValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyGBps", copyGBpsValue);
   REJECT_STATUS;
 
   napi_status status;
@@ -114,8 +314,8 @@ napi_value hostAccess(napi_env env, napi_callback_info info) {
 
   void* data = nullptr;
   size_t dataSize = 0;
+  napi_value srcBufVal = nullptr;
   if (argc > 1) {
-    napi_value srcBufVal = nullptr;
     napi_valuetype t;
     status = napi_typeof(env, args[1], &t);
     CHECK_STATUS;
@@ -151,14 +351,18 @@ napi_value hostAccess(napi_env env, napi_callback_info info) {
       bool isBuffer;
       status = napi_is_buffer(env, srcBufVal, &isBuffer);
       CHECK_STATUS;
-      if (!isBuffer) {
-        napi_throw_type_error(env, nullptr, "Optional third argument must be a buffer - the source data.");
+      status = napi_typeof(env, srcBufVal, &t);
+      CHECK_STATUS;
+      if (isBuffer) {
+        status = napi_get_buffer_info(env, srcBufVal, &data, &dataSize);
+        CHECK_STATUS;
+      } else if (t == napi_object) {
+        c->hasRegion = true;
+      } else {
+        napi_throw_type_error(env, nullptr, "Optional third argument must be a buffer - the source data, or an object - the region.");
         delete c;
         return nullptr;
       }
-
-      status = napi_get_buffer_info(env, srcBufVal, &data, &dataSize);
-      CHECK_STATUS;
     }
   }
 
@@ -174,6 +378,31 @@ napi_value hostAccess(napi_env env, napi_callback_info info) {
   status = napi_get_value_external(env, clMemValue, (void**)&c->clMem);
   CHECK_STATUS;
 
+  size_t numBytes = c->clMem->numBytes();
+  c->length = numBytes;
+  if (c->hasRegion) {
+    if (eMemFlags::NONE == c->haFlags) {
+      status = napi_throw_error(env, nullptr, "Host access region requires an access direction other than 'none'.");
+      delete c;
+      return nullptr;
+    }
+    bool valid = true;
+    status = getOptionalSize(env, srcBufVal, "offset", c->offset, valid);
+    CHECK_STATUS;
+    c->length = (valid && (c->offset < numBytes)) ? numBytes - c->offset : 0;
+    status = getOptionalSize(env, srcBufVal, "length", c->length, valid);
+    CHECK_STATUS;
+    if (!valid || (0 == c->length) || (c->offset + c->length > numBytes)) {
+      status = napi_throw_range_error(env, nullptr, "Host access region must be within the buffer and not empty.");
+      delete c;
+      return nullptr;
+    }
+
+    // hold the buffer to create the view of the region
+    status = napi_create_reference(env, bufferValue, 1, &c->passthru);
+    CHECK_STATUS;
+  }
+
   if (data) {
     if (dataSize > c->clMem->numBytes()) {
       printf("Source buffer is larger than requested OpenCL allocation - trimming.\n");
@@ -181,6 +410,10 @@ napi_value hostAccess(napi_env env, napi_callback_info info) {
     }
     c->srcBuf = data;
     c->srcBufSize = dataSize;
+
+    // hold the source buffer until the copy is complete
+    status = napi_create_reference(env, srcBufVal, 1, &c->passthru);
+    CHECK_STATUS;
   }
 
   napi_value promise, resource_name;
@@ -195,12 +428,692 @@ napi_value hostAccess(napi_env env, napi_callback_info info) {
   status = napi_queue_async_work(env, c->_request);
   CHECK_STATUS;
 
-  return promise;
+  return promise;
+}
+
+struct hostAccessItem {
+  iClMemory *clMem = nullptr;
+  eMemFlags haFlags = eMemFlags::NONE;
+  void *srcBuf = nullptr;
+  size_t srcBufSize = 0;
+};
+
+struct hostAccessManyCarrier : carrier {
+  std::vector<hostAccessItem> items;
+  uint32_t queueNum = 0;
+  cl_command_queue commandQueue = nullptr;
+  bool waitFinish = true;
+  size_t copyBytes = 0;
+  long long copyTime = 0;
+  bool copyQueued = false;
+};
+
+void hostAccessManyCopyExecute(napi_env env, void* data) {
+  hostAccessManyCarrier* c = (hostAccessManyCarrier*) data;
+  cl_int error;
+
+  HR_TIME_POINT copyStart = NOW;
+  for (auto& item: c->items) {
+    if (item.srcBuf) {
+      error = item.clMem->copyFrom(item.srcBuf, item.srcBufSize);
+      ASYNC_CL_ERROR;
+      c->copyBytes += item.srcBufSize;
+    }
+  }
+  c->copyTime = microTime(copyStart);
+  c->totalTime += c->copyTime;
+}
+
+void hostAccessManyExecute(napi_env env, void* data) {
+  hostAccessManyCarrier* c = (hostAccessManyCarrier*) data;
+  cl_int error;
+
+  HR_TIME_POINT start = NOW;
+
+  // enqueue every map before a single marker, rather than waiting for each buffer in turn
+  for (auto& item: c->items) {
+    error = item.clMem->setHostAccess(item.haFlags, c->queueNum, 0, item.clMem->numBytes(), false);
+    ASYNC_CL_ERROR;
+  }
+  c->totalTime = microTime(start);
+
+  if (c->waitFinish) {
+    cl_event ready;
+    error = clEnqueueMarkerWithWaitList(c->commandQueue, 0, nullptr, &ready);
+    ASYNC_CL_ERROR;
+    c->completeEvents.push_back(ready);
+    c->waitStart = NOW;
+    error = clFlush(c->commandQueue);
+    ASYNC_CL_ERROR;
+  } else
+    hostAccessManyCopyExecute(env, data);
+}
+
+void hostAccessManyComplete(napi_env env, napi_status asyncStatus, void* data) {
+  hostAccessManyCarrier* c = (hostAccessManyCarrier*) data;
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async host access to many buffers failed to complete.";
+  }
+  if (deferComplete(env, c, hostAccessManyComplete)) return;
+  REJECT_STATUS;
+
+  // source copies follow the maps in a further stage, off the JavaScript thread
+  if (c->eventsComplete && !c->copyQueued) {
+    c->totalTime += c->waitTime;
+    c->copyQueued = true;
+    if (std::any_of(c->items.begin(), c->items.end(), [](const hostAccessItem& item) { return item.srcBuf; })) {
+      c->status = queueNextStage(env, c, "HostAccessManyCopy", hostAccessManyCopyExecute, hostAccessManyComplete);
+      REJECT_STATUS;
+      return;
+    }
+  }
+
+  napi_value result;
+  c->status = napi_create_object(env, &result);
+  REJECT_STATUS;
+
+  napi_value totalValue;
+  c->status = napi_create_int64(env, (int64_t) c->totalTime, &totalValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "totalTime", totalValue);
+  REJECT_STATUS;
+
+  napi_value copyBytesValue;
+  c->status = napi_create_int64(env, (int64_t) c->copyBytes, &copyBytesValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyBytes", copyBytesValue);
+  REJECT_STATUS;
+
+  napi_value copyTimeValue;
+  c->status = napi_create_int64(env, (int64_t) c->copyTime, &copyTimeValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyTime", copyTimeValue);
+  REJECT_STATUS;
+
+  // bytes per microsecond / 1000 gives GB/s
+  double copyGBps = (c->copyBytes && c->copyTime > 0) ? (double)c->copyBytes / c->copyTime / 1000.0 : 0.0;
+  napi_value copyGBpsValue;
+  c->status = napi_create_double(env, copyGBps, &copyGBpsValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyGBps", copyGBpsValue);
+  REJECT_STATUS;
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+napi_value hostAccessMany(napi_env env, napi_callback_info info) {
+  napi_status status;
+  hostAccessManyCarrier* c = new hostAccessManyCarrier;
+
+  napi_value args[2];
+  size_t argc = 2;
+  napi_value contextValue;
+  status = napi_get_cb_info(env, info, &argc, args, &contextValue, nullptr);
+  CHECK_STATUS;
+
+  bool isArray = false;
+  if (argc > 0) {
+    status = napi_is_array(env, args[0], &isArray);
+    CHECK_STATUS;
+  }
+  if (!isArray) {
+    status = napi_throw_type_error(env, nullptr, "First argument must be an array of host access requests.");
+    delete c;
+    return nullptr;
+  }
+
+  uint32_t numQueues;
+  napi_value numQueuesVal;
+  status = napi_get_named_property(env, contextValue, "numQueues", &numQueuesVal);
+  CHECK_STATUS;
+  status = napi_get_value_uint32(env, numQueuesVal, &numQueues);
+  CHECK_STATUS;
+
+  int32_t queueNum = 0;
+  if (argc > 1) {
+    status = napi_get_value_int32(env, args[1], &queueNum);
+    if ((napi_ok != status) || !((queueNum >= 0) && (queueNum < (int32_t)numQueues))) {
+      status = napi_throw_range_error(env, nullptr, "Optional parameter queueNum out of range.");
+      delete c;
+      return nullptr;
+    }
+  }
+  c->queueNum = (uint32_t)queueNum;
+  c->waitFinish = (1 == numQueues);
+
+  uint32_t numItems;
+  status = napi_get_array_length(env, args[0], &numItems);
+  CHECK_STATUS;
+
+  // hold the buffers and sources until the work is complete
+  napi_value holdValue;
+  status = napi_create_array_with_length(env, numItems * 2, &holdValue);
+  CHECK_STATUS;
+
+  for (uint32_t i = 0; i < numItems; ++i) {
+    napi_value itemValue;
+    status = napi_get_element(env, args[0], i, &itemValue);
+    CHECK_STATUS;
+    napi_valuetype t;
+    status = napi_typeof(env, itemValue, &t);
+    CHECK_STATUS;
+    bool hasProp = false;
+    napi_value bufValue = nullptr;
+    if (t == napi_object) {
+      status = napi_get_named_property(env, itemValue, "buf", &bufValue);
+      CHECK_STATUS;
+      status = napi_typeof(env, bufValue, &t);
+      CHECK_STATUS;
+      if (t == napi_object) {
+        status = napi_has_named_property(env, bufValue, "clMemory", &hasProp);
+        CHECK_STATUS;
+      }
+    }
+    if (!hasProp) {
+      status = napi_throw_type_error(env, nullptr, "Each host access request must have an OpenCL buffer as buf.");
+      delete c;
+      return nullptr;
+    }
+
+    hostAccessItem item;
+    napi_value clMemValue;
+    status = napi_get_named_property(env, bufValue, "clMemory", &clMemValue);
+    CHECK_STATUS;
+    status = napi_get_value_external(env, clMemValue, (void**)&item.clMem);
+    CHECK_STATUS;
+    status = napi_set_element(env, holdValue, i * 2, bufValue);
+    CHECK_STATUS;
+
+    napi_value dirValue;
+    status = napi_get_named_property(env, itemValue, "dir", &dirValue);
+    CHECK_STATUS;
+    char haflag[10] = "";
+    status = napi_get_value_string_utf8(env, dirValue, haflag, 10, nullptr);
+    if ((napi_ok != status) || ((strcmp(haflag, "readwrite") != 0) && (strcmp(haflag, "writeonly") != 0) &&
+                                (strcmp(haflag, "readonly") != 0) && (strcmp(haflag, "none") != 0))) {
+      status = napi_throw_error(env, nullptr, "Host access direction must be one of 'none', 'readwrite', 'writeonly' or 'readonly'.");
+      delete c;
+      return nullptr;
+    }
+    item.haFlags = (0==strcmp("readwrite", haflag)) ? eMemFlags::READWRITE :
+                   (0==strcmp("writeonly", haflag)) ? eMemFlags::WRITEONLY :
+                   (0==strcmp("readonly", haflag)) ? eMemFlags::READONLY :
+                   eMemFlags::NONE;
+
+    napi_value srcValue;
+    status = napi_get_named_property(env, itemValue, "src", &srcValue);
+    CHECK_STATUS;
+    status = napi_typeof(env, srcValue, &t);
+    CHECK_STATUS;
+    if (t != napi_undefined) {
+      bool isBuffer;
+      status = napi_is_buffer(env, srcValue, &isBuffer);
+      CHECK_STATUS;
+      if (!isBuffer || (eMemFlags::READONLY == item.haFlags) || (eMemFlags::NONE == item.haFlags)) {
+        status = napi_throw_type_error(env, nullptr, "Host access source must be a buffer, with access that is not readonly or none.");
+        delete c;
+        return nullptr;
+      }
+      status = napi_get_buffer_info(env, srcValue, &item.srcBuf, &item.srcBufSize);
+      CHECK_STATUS;
+      if (item.srcBufSize > item.clMem->numBytes()) {
+        printf("Source buffer is larger than requested OpenCL allocation - trimming.\n");
+        item.srcBufSize = item.clMem->numBytes();
+      }
+      status = napi_set_element(env, holdValue, i * 2 + 1, srcValue);
+      CHECK_STATUS;
+    }
+    c->items.push_back(item);
+  }
+
+  std::stringstream ss;
+  ss << "commands_" << c->queueNum;
+  napi_value commandQueueVal;
+  status = napi_get_named_property(env, contextValue, ss.str().c_str(), &commandQueueVal);
+  CHECK_STATUS;
+  status = napi_get_value_external(env, commandQueueVal, (void**)&c->commandQueue);
+  CHECK_STATUS;
+
+  status = napi_create_reference(env, holdValue, 1, &c->passthru);
+  CHECK_STATUS;
+
+  napi_value promise, resource_name;
+  status = napi_create_promise(env, &c->_deferred, &promise);
+  CHECK_STATUS;
+
+  status = napi_create_string_utf8(env, "HostAccessMany", NAPI_AUTO_LENGTH, &resource_name);
+  CHECK_STATUS;
+  status = napi_create_async_work(env, NULL, resource_name, hostAccessManyExecute,
+    hostAccessManyComplete, c, &c->_request);
+  CHECK_STATUS;
+  status = napi_queue_async_work(env, c->_request);
+  CHECK_STATUS;
+
+  return promise;
+}
+
+struct fillCarrier : carrier {
+  iClMemory *clMem = nullptr;
+  std::vector<uint8_t> pattern;
+  bool isImage = false;
+  size_t offset = 0;
+  size_t size = 0;
+  uint32_t queueNum = 0;
+};
+
+void fillExecute(napi_env env, void* data) {
+  fillCarrier* c = (fillCarrier*) data;
+  cl_int error;
+
+  HR_TIME_POINT start = NOW;
+
+  if (c->isImage)
+    error = c->clMem->fillImage(c->pattern.data(), c->queueNum);
+  else
+    error = c->clMem->fill(c->pattern.data(), c->pattern.size(), c->offset, c->size, c->queueNum);
+  ASYNC_CL_ERROR;
+
+  c->totalTime = microTime(start);
+}
+
+void fillComplete(napi_env env, napi_status asyncStatus, void* data) {
+  fillCarrier* c = (fillCarrier*) data;
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async buffer fill failed to complete.";
+  }
+  REJECT_STATUS;
+
+  napi_value result;
+  c->status = napi_create_object(env, &result);
+  REJECT_STATUS;
+
+  napi_value totalValue;
+  c->status = napi_create_int64(env, (int64_t) c->totalTime, &totalValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "totalTime", totalValue);
+  REJECT_STATUS;
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+// Converts an array of up to four colour components to the fill colour type for the image format
+bool imageFillColour(napi_env env, napi_value colourValue, const cl_image_format& imageFormat, std::vector<uint8_t>& fillColour) {
+  napi_status status;
+  uint32_t numComponents;
+  status = napi_get_array_length(env, colourValue, &numComponents);
+  if ((napi_ok != status) || (0 == numComponents) || (numComponents > 4))
+    return false;
+
+  fillColour.assign(16, 0);
+  for (uint32_t i = 0; i < numComponents; ++i) {
+    napi_value element;
+    double component;
+    status = napi_get_element(env, colourValue, i, &element);
+    if (napi_ok != status)
+      return false;
+    status = napi_get_value_double(env, element, &component);
+    if (napi_ok != status)
+      return false;
+
+    switch (imageFormat.image_channel_data_type) {
+    case CL_SIGNED_INT8:
+    case CL_SIGNED_INT16:
+    case CL_SIGNED_INT32:
+      ((cl_int *)fillColour.data())[i] = (cl_int)component; break;
+    case CL_UNSIGNED_INT8:
+    case CL_UNSIGNED_INT16:
+    case CL_UNSIGNED_INT32:
+      ((cl_uint *)fillColour.data())[i] = (cl_uint)component; break;
+    default:
+      ((cl_float *)fillColour.data())[i] = (cl_float)component; break;
+    }
+  }
+  return true;
+}
+
+napi_value fill(napi_env env, napi_callback_info info) {
+  napi_status status;
+
+  napi_value args[4];
+  size_t argc = 4;
+  napi_value bufferValue;
+  status = napi_get_cb_info(env, info, &argc, args, &bufferValue, nullptr);
+  CHECK_STATUS;
+
+  // Without an options object this is the normal synchronous Buffer fill on host memory
+  bool isDeviceFill = false;
+  if (argc >= 2) {
+    napi_valuetype t;
+    status = napi_typeof(env, args[1], &t);
+    CHECK_STATUS;
+    bool isBuffer, isTypedArray;
+    status = napi_is_buffer(env, args[1], &isBuffer);
+    CHECK_STATUS;
+    status = napi_is_typedarray(env, args[1], &isTypedArray);
+    CHECK_STATUS;
+    isDeviceFill = (t == napi_object) && !isBuffer && !isTypedArray;
+  }
+  if (!isDeviceFill) {
+    napi_value prototype, bufferFill, result;
+    status = napi_get_prototype(env, bufferValue, &prototype);
+    CHECK_STATUS;
+    status = napi_get_named_property(env, prototype, "fill", &bufferFill);
+    CHECK_STATUS;
+    status = napi_call_function(env, bufferValue, bufferFill, argc, args, &result);
+    if (napi_pending_exception == status)
+      return nullptr;
+    CHECK_STATUS;
+    return result;
+  }
+
+  fillCarrier* c = new fillCarrier;
+  napi_value clMemValue;
+  status = napi_get_named_property(env, bufferValue, "clMemory", &clMemValue);
+  CHECK_STATUS;
+  status = napi_get_value_external(env, clMemValue, (void**)&c->clMem);
+  CHECK_STATUS;
+
+  napi_valuetype t;
+  status = napi_typeof(env, args[0], &t);
+  CHECK_STATUS;
+  bool isArray, isBuffer, isTypedArray;
+  status = napi_is_array(env, args[0], &isArray);
+  CHECK_STATUS;
+  status = napi_is_buffer(env, args[0], &isBuffer);
+  CHECK_STATUS;
+  status = napi_is_typedarray(env, args[0], &isTypedArray);
+  CHECK_STATUS;
+  if (t == napi_number) {
+    uint32_t byteValue;
+    status = napi_get_value_uint32(env, args[0], &byteValue);
+    CHECK_STATUS;
+    c->pattern.push_back((uint8_t)byteValue);
+  } else if (isBuffer) {
+    void *patternData;
+    size_t patternBytes;
+    status = napi_get_buffer_info(env, args[0], &patternData, &patternBytes);
+    CHECK_STATUS;
+    c->pattern.assign((uint8_t *)patternData, (uint8_t *)patternData + patternBytes);
+  } else if (isTypedArray) {
+    napi_typedarray_type arrayType;
+    size_t arrayLength, byteOffset;
+    void *arrayData;
+    napi_value arrayBuffer;
+    status = napi_get_typedarray_info(env, args[0], &arrayType, &arrayLength, &arrayData, &arrayBuffer, &byteOffset);
+    CHECK_STATUS;
+    size_t elementBytes = 0;
+    switch (arrayType) {
+    case napi_int8_array: case napi_uint8_array: case napi_uint8_clamped_array: elementBytes = 1; break;
+    case napi_int16_array: case napi_uint16_array: elementBytes = 2; break;
+    case napi_int32_array: case napi_uint32_array: case napi_float32_array: elementBytes = 4; break;
+    case napi_float64_array: case napi_bigint64_array: case napi_biguint64_array: elementBytes = 8; break;
+    default:
+      status = napi_throw_type_error(env, nullptr, "Unsupported typed array type for a fill pattern.");
+      delete c;
+      return nullptr;
+    }
+    c->pattern.assign((uint8_t *)arrayData, (uint8_t *)arrayData + arrayLength * elementBytes);
+  } else if (isArray) {
+    if (!c->clMem->hasDimensions()) {
+      status = napi_throw_error(env, nullptr, "A fill colour requires a buffer with image dimensions.");
+      delete c;
+      return nullptr;
+    }
+    if (!imageFillColour(env, args[0], c->clMem->imageFormat(), c->pattern)) {
+      status = napi_throw_type_error(env, nullptr, "Fill colour must be an array of one to four numbers.");
+      delete c;
+      return nullptr;
+    }
+    c->isImage = true;
+  } else {
+    status = napi_throw_type_error(env, nullptr, "Fill pattern must be a number, a Buffer, a typed array or an array colour.");
+    delete c;
+    return nullptr;
+  }
+
+  size_t patternBytes = c->pattern.size();
+  if (!c->isImage && ((0 == patternBytes) || (patternBytes > 128) || (patternBytes & (patternBytes - 1)))) {
+    status = napi_throw_range_error(env, nullptr, "Fill pattern size must be a power of two between 1 and 128 bytes.");
+    delete c;
+    return nullptr;
+  }
+
+  napi_value options = args[1];
+  napi_value numQueuesValue;
+  uint32_t numQueues = 1;
+  status = napi_get_named_property(env, bufferValue, "numQueues", &numQueuesValue);
+  CHECK_STATUS;
+  status = napi_get_value_uint32(env, numQueuesValue, &numQueues);
+  CHECK_STATUS;
+
+  size_t queueNum = 0;
+  bool valid = true;
+  status = getOptionalSize(env, options, "queueNum", queueNum, valid);
+  CHECK_STATUS;
+  if (!valid || (queueNum >= numQueues)) {
+    status = napi_throw_range_error(env, nullptr, "Optional parameter queueNum out of range.");
+    delete c;
+    return nullptr;
+  }
+  c->queueNum = (uint32_t)queueNum;
+
+  size_t numBytes = c->clMem->numBytes();
+  status = getOptionalSize(env, options, "offset", c->offset, valid);
+  CHECK_STATUS;
+  c->size = (c->offset < numBytes) ? numBytes - c->offset : 0;
+  status = getOptionalSize(env, options, "size", c->size, valid);
+  CHECK_STATUS;
+  if (!valid || (c->offset + c->size > numBytes)) {
+    status = napi_throw_range_error(env, nullptr, "Fill offset and size must be within the buffer.");
+    delete c;
+    return nullptr;
+  }
+  if (!c->isImage && ((c->offset % patternBytes) || (c->size % patternBytes))) {
+    status = napi_throw_range_error(env, nullptr, "Fill offset and size must be multiples of the pattern size.");
+    delete c;
+    return nullptr;
+  }
+
+  status = napi_create_reference(env, bufferValue, 1, &c->passthru);
+  CHECK_STATUS;
+
+  napi_value promise, resource_name;
+  status = napi_create_promise(env, &c->_deferred, &promise);
+  CHECK_STATUS;
+
+  status = napi_create_string_utf8(env, "Fill", NAPI_AUTO_LENGTH, &resource_name);
+  CHECK_STATUS;
+  status = napi_create_async_work(env, NULL, resource_name, fillExecute,
+    fillComplete, c, &c->_request);
+  CHECK_STATUS;
+  status = napi_queue_async_work(env, c->_request);
+  CHECK_STATUS;
+
+  return promise;
+}
+
+struct migrateCarrier : carrier {
+  iClMemory *clMem = nullptr;
+  bool toHost = false;
+  uint32_t queueNum = 0;
+};
+
+void migrateExecute(napi_env env, void* data) {
+  migrateCarrier* c = (migrateCarrier*) data;
+  cl_int error;
+
+  HR_TIME_POINT start = NOW;
+
+  error = c->clMem->migrate(c->toHost, c->queueNum);
+  ASYNC_CL_ERROR;
+
+  c->totalTime = microTime(start);
+}
+
+void migrateComplete(napi_env env, napi_status asyncStatus, void* data) {
+  migrateCarrier* c = (migrateCarrier*) data;
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async buffer migrate failed to complete.";
+  }
+  REJECT_STATUS;
+
+  napi_value result;
+  c->status = napi_create_object(env, &result);
+  REJECT_STATUS;
+
+  napi_value totalValue;
+  c->status = napi_create_int64(env, (int64_t) c->totalTime, &totalValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "totalTime", totalValue);
+  REJECT_STATUS;
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+napi_value migrate(napi_env env, napi_callback_info info) {
+  napi_status status;
+
+  napi_value args[2];
+  size_t argc = 2;
+  napi_value bufferValue;
+  status = napi_get_cb_info(env, info, &argc, args, &bufferValue, nullptr);
+  CHECK_STATUS;
+
+  if (argc < 1) {
+    status = napi_throw_error(env, nullptr, "Buffer migrate requires a direction of 'device' or 'host'.");
+    return nullptr;
+  }
+  char dir[8] = "";
+  status = napi_get_value_string_utf8(env, args[0], dir, 8, nullptr);
+  if ((napi_ok != status) || ((strcmp(dir, "device") != 0) && (strcmp(dir, "host") != 0))) {
+    status = napi_throw_error(env, nullptr, "Buffer migrate direction must be one of 'device' or 'host'.");
+    return nullptr;
+  }
+
+  napi_value numQueuesValue;
+  uint32_t numQueues = 1;
+  status = napi_get_named_property(env, bufferValue, "numQueues", &numQueuesValue);
+  CHECK_STATUS;
+  status = napi_get_value_uint32(env, numQueuesValue, &numQueues);
+  CHECK_STATUS;
+
+  int32_t queueNum = 0;
+  if (argc > 1) {
+    status = napi_get_value_int32(env, args[1], &queueNum);
+    if ((napi_ok != status) || !((queueNum >= 0) && (queueNum < (int32_t)numQueues))) {
+      status = napi_throw_range_error(env, nullptr, "Optional parameter queueNum out of range.");
+      return nullptr;
+    }
+  }
+
+  migrateCarrier* c = new migrateCarrier;
+  c->toHost = (0 == strcmp("host", dir));
+  c->queueNum = (uint32_t)queueNum;
+
+  napi_value clMemValue;
+  status = napi_get_named_property(env, bufferValue, "clMemory", &clMemValue);
+  CHECK_STATUS;
+  status = napi_get_value_external(env, clMemValue, (void**)&c->clMem);
+  CHECK_STATUS;
+
+  status = napi_create_reference(env, bufferValue, 1, &c->passthru);
+  CHECK_STATUS;
+
+  napi_value promise, resource_name;
+  status = napi_create_promise(env, &c->_deferred, &promise);
+  CHECK_STATUS;
+
+  status = napi_create_string_utf8(env, "Migrate", NAPI_AUTO_LENGTH, &resource_name);
+  CHECK_STATUS;
+  status = napi_create_async_work(env, NULL, resource_name, migrateExecute,
+    migrateComplete, c, &c->_request);
+  CHECK_STATUS;
+  status = napi_queue_async_work(env, c->_request);
+  CHECK_STATUS;
+
+  return promise;
+}
+
+struct contextExternals {
+  cl_context context = nullptr;
+  std::vector<cl_command_queue> commandQueues;
+  deviceInfo *devInfo = nullptr;
+  std::shared_ptr<iClMemPool> *memPool = nullptr;
+  std::shared_ptr<iHostCopy> *hostCopy = nullptr;
+  std::shared_ptr<iStagingRing> *staging = nullptr;
+};
+
+napi_status getContextExternals(napi_env env, napi_value contextValue, contextExternals& ext) {
+  napi_status status;
+  napi_value jsContext;
+  void* contextData;
+  status = napi_get_named_property(env, contextValue, "context", &jsContext);
+  PASS_STATUS;
+  status = napi_get_value_external(env, jsContext, &contextData);
+  PASS_STATUS;
+  ext.context = (cl_context) contextData;
+
+  napi_value numQueuesVal;
+  uint32_t numQueues = 1;
+  status = napi_get_named_property(env, contextValue, "numQueues", &numQueuesVal);
+  PASS_STATUS;
+  status = napi_get_value_uint32(env, numQueuesVal, &numQueues);
+  PASS_STATUS;
+
+  ext.commandQueues.resize(numQueues);
+  for (uint32_t i = 0; i < numQueues; ++i) {
+    std::stringstream ss;
+    ss << "commands_" << i;
+    napi_value commandQueue;
+    status = napi_get_named_property(env, contextValue, ss.str().c_str(), &commandQueue);
+    PASS_STATUS;
+    status = napi_get_value_external(env, commandQueue, (void**)&ext.commandQueues.at(i));
+    PASS_STATUS;
+  }
+
+  napi_value jsDevInfo;
+  status = napi_get_named_property(env, contextValue, "deviceInfo", &jsDevInfo);
+  PASS_STATUS;
+  status = napi_get_value_external(env, jsDevInfo, (void**)&ext.devInfo);
+  PASS_STATUS;
+
+  napi_value memPoolValue;
+  status = napi_get_named_property(env, contextValue, "memPool", &memPoolValue);
+  PASS_STATUS;
+  status = napi_get_value_external(env, memPoolValue, (void**)&ext.memPool);
+  PASS_STATUS;
+
+  napi_value hostCopyValue;
+  status = napi_get_named_property(env, contextValue, "hostCopy", &hostCopyValue);
+  PASS_STATUS;
+  status = napi_get_value_external(env, hostCopyValue, (void**)&ext.hostCopy);
+  PASS_STATUS;
+
+  napi_value stagingValue;
+  status = napi_get_named_property(env, contextValue, "staging", &stagingValue);
+  PASS_STATUS;
+  status = napi_get_value_external(env, stagingValue, (void**)&ext.staging);
+  return status;
 }
 
 void finalizeClMemory(napi_env env, void* data, void* hint) {
   iClMemory *clMem = (iClMemory*)data;
-  printf("Finalizing OpenCL memory of type %s, size %d.\n", clMem->svmTypeName().c_str(), clMem->numBytes());
+  printf("Finalizing OpenCL memory of type %s, size %zu.\n", clMem->svmTypeName().c_str(), clMem->numBytes());
   delete clMem;
 }
 
@@ -220,7 +1133,7 @@ napi_value freeAllocation(napi_env env, napi_callback_info info) {
   status = napi_get_cb_info(env, info, &argc, args, &bufferValue, (void**)&clMem);
   CHECK_STATUS;
 
-  // printf("Freeing OpenCL memory of type %s, size %d.\n", clMem->svmTypeName().c_str(), clMem->numBytes());
+  // printf("Freeing OpenCL memory of type %s, size %zu.\n", clMem->svmTypeName().c_str(), clMem->numBytes());
   clMem->freeAllocation();
 
   napi_value result;
@@ -231,13 +1144,23 @@ napi_value freeAllocation(napi_env env, napi_callback_info info) {
 
 void createBufferExecute(napi_env env, void* data) {
   createBufCarrier* c = (createBufCarrier*) data;
-  // printf("Create a buffer of type %s, size %d.\n", c->clMem->svmTypeName().c_str(), c->clMem->numBytes());
+  // printf("Create a buffer of type %s, size %zu.\n", c->clMem->svmTypeName().c_str(), c->clMem->numBytes());
 
   HR_TIME_POINT start = NOW;
 
+  if (!c->clMem)
+    c->clMem = c->createMem();
   if (!c->clMem->allocate()) {
     c->status = NODEN_ALLOCATION_FAILURE;
     c->errorMsg = "Failed to allocate memory for buffer.";
+    return;
+  }
+
+  if (c->srcBuf && !c->clMem->isWrapped()) {
+    cl_int error = c->clMem->setHostAccess(eMemFlags::WRITEONLY, 0, 0, c->clMem->numBytes(), true);
+    ASYNC_CL_ERROR;
+    error = c->clMem->copyFrom(c->srcBuf, c->srcBufSize);
+    ASYNC_CL_ERROR;
   }
 
   c->totalTime = microTime(start);
@@ -255,12 +1178,46 @@ void createBufferComplete(napi_env env, napi_status asyncStatus, void* data) {
   c->status = napi_create_external_buffer(env, c->clMem->numBytes(), c->clMem->hostBuf(), nullptr, nullptr, &result);
   REJECT_STATUS;
 
+  if (c->clMem->isWrapped()) {
+    napi_ref wrapRef;
+    napi_value srcBufValue;
+    c->status = napi_get_reference_value(env, c->passthru, &srcBufValue);
+    REJECT_STATUS;
+    c->status = napi_create_reference(env, srcBufValue, 1, &wrapRef);
+    REJECT_STATUS;
+    // a wrapped buffer holds the Javascript memory that it uses until the OpenCL memory is released after the
+    // work queued before release, which may be after the buffer has been garbage collected
+    void* wrapRelease = prepareRefRelease(env, wrapRef);
+    if (!wrapRelease) {
+      napi_delete_reference(env, wrapRef);
+      c->status = napi_generic_failure;
+      c->errorMsg = "Failed to hold the source memory of a wrapped buffer.";
+      REJECT_STATUS;
+    }
+    c->clMem->setWrapRelease(releaseRef, wrapRelease);
+  }
+
   napi_value clMemValue;
   c->status = napi_create_external(env, c->clMem, finalizeClMemory, nullptr, &clMemValue);
   REJECT_STATUS;
   c->status = napi_set_named_property(env, result, "clMemory", clMemValue);
   REJECT_STATUS;
 
+  if (c->srcBuf) {
+    napi_value wrappedValue;
+    c->status = napi_get_boolean(env, c->clMem->isWrapped(), &wrappedValue);
+    REJECT_STATUS;
+    c->status = napi_set_named_property(env, result, "wrapped", wrappedValue);
+    REJECT_STATUS;
+  }
+
+  // the type in use, as chosen natively for bufType 'auto' and wrapped memory
+  napi_value bufTypeValue;
+  c->status = napi_create_string_utf8(env, c->clMem->svmTypeName().c_str(), NAPI_AUTO_LENGTH, &bufTypeValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "bufType", bufTypeValue);
+  REJECT_STATUS;
+
   napi_value numQueuesValue;
   c->status = napi_create_uint32(env, c->numQueues, &numQueuesValue);
   REJECT_STATUS;
@@ -274,7 +1231,7 @@ void createBufferComplete(napi_env env, napi_status asyncStatus, void* data) {
   REJECT_STATUS;
 
   napi_value numBytesValue;
-  c->status = napi_create_uint32(env, (int32_t) c->clMem->numBytes(), &numBytesValue);
+  c->status = napi_create_int64(env, (int64_t) c->clMem->numBytes(), &numBytesValue);
   REJECT_STATUS;
   c->status = napi_set_named_property(env, result, "numBytes", numBytesValue);
   REJECT_STATUS;
@@ -292,6 +1249,20 @@ void createBufferComplete(napi_env env, napi_status asyncStatus, void* data) {
   c->status = napi_set_named_property(env, result, "hostAccess", hostAccessValue);
   REJECT_STATUS;
 
+  napi_value fillValue;
+  c->status = napi_create_function(env, "fill", NAPI_AUTO_LENGTH,
+    fill, nullptr, &fillValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "fill", fillValue);
+  REJECT_STATUS;
+
+  napi_value migrateValue;
+  c->status = napi_create_function(env, "migrate", NAPI_AUTO_LENGTH,
+    migrate, nullptr, &migrateValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "migrate", migrateValue);
+  REJECT_STATUS;
+
   napi_value freeAllocValue;
   c->status = napi_create_function(env, "freeAllocation", NAPI_AUTO_LENGTH,
     freeAllocation, c->clMem, &freeAllocValue);
@@ -330,15 +1301,15 @@ napi_value createBuffer(napi_env env, napi_callback_info info) {
     delete c;
     return nullptr;
   }
-  int32_t paramSize;
-  status = napi_get_value_int32(env, args[0], &paramSize);
+  int64_t paramSize;
+  status = napi_get_value_int64(env, args[0], &paramSize);
   CHECK_STATUS;
   if (paramSize < 0) {
     status = napi_throw_error(env, nullptr, "Size of the buffer cannot be negative.");
     delete c;
     return nullptr;
   }
-  uint32_t numBytes = (uint32_t)paramSize;
+  size_t numBytes = (size_t)paramSize;
 
   status = napi_typeof(env, args[1], &t);
   CHECK_STATUS;
@@ -387,13 +1358,16 @@ napi_value createBuffer(napi_env env, napi_callback_info info) {
 
   if ((strcmp(svmFlag, "fine") != 0) &&
     (strcmp(svmFlag, "coarse") != 0) &&
+    (strcmp(svmFlag, "staged") != 0) &&
+    (strcmp(svmFlag, "auto") != 0) &&
     (strcmp(svmFlag, "none") != 0)) {
-    status = napi_throw_error(env, nullptr, "Buffer type must be one of 'fine', 'coarse' or 'none'.");
+    status = napi_throw_error(env, nullptr, "Buffer type must be one of 'fine', 'coarse', 'staged', 'auto' or 'none'.");
     delete c;
     return nullptr;
   }
   eSvmType svmType = (0 == strcmp(svmFlag, "fine")) ? eSvmType::FINE :
                      (0 == strcmp(svmFlag, "coarse")) ? eSvmType::COARSE :
+                     (0 == strcmp(svmFlag, "staged")) ? eSvmType::STAGED :
                      eSvmType::NONE;
 
   if (((eSvmType::FINE == svmType) && ((svmCaps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER) == 0)) ||
@@ -403,7 +1377,8 @@ napi_value createBuffer(napi_env env, napi_callback_info info) {
     return nullptr;
   }
 
-  std::array<uint32_t, 3> imageDims = {0, 0, 0};
+  std::array<uint32_t, 3> imageDims = {{0, 0, 0}};
+  cl_image_format imageFormat = { CL_RGBA, CL_FLOAT };
   if (argc == 4) {
     napi_value dimsValue = args[3];
     status = napi_typeof(env, dimsValue, &t);
@@ -441,56 +1416,223 @@ napi_value createBuffer(napi_env env, napi_callback_info info) {
       status = napi_get_value_uint32(env, depthValue, &imageDims[2]);
       CHECK_STATUS;
     }
+
+    status = napi_has_named_property(env, dimsValue, "channelOrder", &hasProp);
+    CHECK_STATUS;
+    if (hasProp) {
+      napi_value channelOrderValue;
+      status = napi_get_named_property(env, dimsValue, "channelOrder", &channelOrderValue);
+      CHECK_STATUS;
+      char channelOrder[16];
+      status = napi_get_value_string_utf8(env, channelOrderValue, channelOrder, 16, nullptr);
+      CHECK_STATUS;
+      if (!lookupFormatName(channelOrderNames, sizeof(channelOrderNames) / sizeof(imageFormatName),
+                            channelOrder, imageFormat.image_channel_order)) {
+        status = napi_throw_error(env, nullptr, "Image channel order not recognised.");
+        delete c;
+        return nullptr;
+      }
+    }
+    status = napi_has_named_property(env, dimsValue, "dataType", &hasProp);
+    CHECK_STATUS;
+    if (hasProp) {
+      napi_value dataTypeValue;
+      status = napi_get_named_property(env, dimsValue, "dataType", &dataTypeValue);
+      CHECK_STATUS;
+      char dataType[20];
+      status = napi_get_value_string_utf8(env, dataTypeValue, dataType, 20, nullptr);
+      CHECK_STATUS;
+      if (!lookupFormatName(dataTypeNames, sizeof(dataTypeNames) / sizeof(imageFormatName),
+                            dataType, imageFormat.image_channel_data_type)) {
+        status = napi_throw_error(env, nullptr, "Image data type not recognised.");
+        delete c;
+        return nullptr;
+      }
+    }
   }
 
   // Extract externals into variables
-  napi_value jsContext;
-  void* contextData;
-  status = napi_get_named_property(env, contextValue, "context", &jsContext);
+  contextExternals ext;
+  status = getContextExternals(env, contextValue, ext);
   CHECK_STATUS;
-  status = napi_get_value_external(env, jsContext, &contextData);
+  c->numQueues = (uint32_t)ext.commandQueues.size();
+  cl_context context = ext.context;
+  deviceInfo *devInfo = ext.devInfo;
+
+  if (numBytes > devInfo->maxAllocBytes) {
+    char errorMsg[200];
+    snprintf(errorMsg, 200, "Buffer size %llu is larger than the device maximum allocation size %llu.",
+      (unsigned long long)numBytes, (unsigned long long)devInfo->maxAllocBytes);
+    status = napi_throw_range_error(env, nullptr, errorMsg);
+    delete c;
+    return nullptr;
+  }
+
+  if (imageDims[0] > 0) {
+    size_t pixelBytes = imagePixelBytes(imageFormat);
+    size_t imageBytes = pixelBytes * imageDims[0] * std::max(imageDims[1], 1U) * std::max(imageDims[2], 1U);
+    if ((0 == pixelBytes) || (imageBytes > numBytes)) {
+      status = napi_throw_error(env, nullptr, "Buffer size is too small for the image dimensions and format.");
+      delete c;
+      return nullptr;
+    }
+
+    cl_mem_flags clMemFlags = (eMemFlags::READONLY == memFlags) ? CL_MEM_READ_ONLY :
+                              (eMemFlags::WRITEONLY == memFlags) ? CL_MEM_WRITE_ONLY :
+                              CL_MEM_READ_WRITE;
+    cl_mem_object_type imageType = imageDims[2] > 1 ? CL_MEM_OBJECT_IMAGE3D : CL_MEM_OBJECT_IMAGE2D;
+    bool supported = false;
+    cl_int error = checkImageFormat(context, devInfo, clMemFlags, imageType, imageFormat, supported);
+    CHECK_CL_ERROR;
+    if (!supported) {
+      status = napi_throw_error(env, nullptr, "Image channel order and data type combination is not supported by device.");
+      delete c;
+      return nullptr;
+    }
+  }
+
+  status = napi_create_reference(env, contextValue, 1, &c->contextRef);
   CHECK_STATUS;
-  cl_context context = (cl_context) contextData;
 
-  napi_value numQueuesVal;
-  status = napi_get_named_property(env, contextValue, "numQueues", &numQueuesVal);
+  // Create holder for host and gpu buffers - for 'auto' the type is measured first unless already known
+  bool autoType = (0 == strcmp(svmFlag, "auto")) && !cachedSvmType(devInfo, numBytes, svmType);
+  if (autoType) {
+    std::vector<cl_command_queue> commandQueues = ext.commandQueues;
+    std::shared_ptr<iClMemPool> memPool = *ext.memPool;
+    std::shared_ptr<iHostCopy> hostCopy = *ext.hostCopy;
+    std::shared_ptr<iStagingRing> staging = *ext.staging;
+    c->createMem = [=]() {
+      eSvmType autoSvmType = selectSvmType(context, commandQueues[0], devInfo, svmCaps, numBytes, memPool, hostCopy, staging);
+      return iClMemory::create(context, commandQueues, memFlags, autoSvmType, numBytes, devInfo, imageDims, imageFormat,
+                               memPool, hostCopy, staging);
+    };
+  } else
+    c->clMem = iClMemory::create(context, ext.commandQueues, memFlags, svmType, numBytes, devInfo, imageDims, imageFormat,
+                                 *ext.memPool, *ext.hostCopy, *ext.staging);
+
+  status = napi_create_reference(env, contextValue, 1, &c->passthru);
   CHECK_STATUS;
-  status = napi_get_value_uint32(env, numQueuesVal, &c->numQueues);
+
+  napi_value promise, resource_name;
+  status = napi_create_promise(env, &c->_deferred, &promise);
   CHECK_STATUS;
 
-  std::vector<cl_command_queue> commandQueues;
-  commandQueues.resize(c->numQueues);
-  for (uint32_t i = 0; i < c->numQueues; ++i) {
-    std::stringstream ss;
-    ss << "commands_" << i;
-    napi_value commandQueue;
-    status = napi_get_named_property(env, contextValue, ss.str().c_str(), &commandQueue);
+  status = napi_create_string_utf8(env, "CreateBuffer", NAPI_AUTO_LENGTH, &resource_name);
+  CHECK_STATUS;
+  status = napi_create_async_work(env, NULL, resource_name, createBufferExecute,
+    createBufferComplete, c, &c->_request);
+  CHECK_STATUS;
+  status = napi_queue_async_work(env, c->_request);
+  CHECK_STATUS;
+
+  return promise;
+}
+
+napi_value wrapBuffer(napi_env env, napi_callback_info info) {
+  napi_status status;
+  createBufCarrier* c = new createBufCarrier;
+
+  napi_value args[2];
+  size_t argc = 2;
+  napi_value contextValue;
+  status = napi_get_cb_info(env, info, &argc, args, &contextValue, nullptr);
+  CHECK_STATUS;
+
+  if (argc != 2) {
+    status = napi_throw_error(env, nullptr, "Wrong number of arguments to wrap buffer.");
+    delete c;
+    return nullptr;
+  }
+
+  bool isBuffer;
+  bool isArrayBuffer;
+  status = napi_is_buffer(env, args[0], &isBuffer);
+  CHECK_STATUS;
+  status = napi_is_arraybuffer(env, args[0], &isArrayBuffer);
+  CHECK_STATUS;
+  if (isBuffer) {
+    status = napi_get_buffer_info(env, args[0], &c->srcBuf, &c->srcBufSize);
     CHECK_STATUS;
-    status = napi_get_value_external(env, commandQueue, (void**)&commandQueues.at(i));
+  } else if (isArrayBuffer) {
+    status = napi_get_arraybuffer_info(env, args[0], &c->srcBuf, &c->srcBufSize);
     CHECK_STATUS;
+  } else {
+    status = napi_throw_type_error(env, nullptr, "First argument must be a Buffer or ArrayBuffer - the memory to wrap.");
+    delete c;
+    return nullptr;
+  }
+  if (0 == c->srcBufSize) {
+    status = napi_throw_error(env, nullptr, "Memory to wrap cannot be empty.");
+    delete c;
+    return nullptr;
   }
 
-  napi_value jsDevInfo;
-  deviceInfo *devInfo;
-  status = napi_get_named_property(env, contextValue, "deviceInfo", &jsDevInfo);
+  napi_valuetype t;
+  status = napi_typeof(env, args[1], &t);
+  CHECK_STATUS;
+  if (t != napi_string) {
+    status = napi_throw_type_error(env, nullptr, "Second argument must be a string - the buffer direction.");
+    delete c;
+    return nullptr;
+  }
+  char memflag[10];
+  status = napi_get_value_string_utf8(env, args[1], memflag, 10, nullptr);
+  CHECK_STATUS;
+  if ((strcmp(memflag, "readwrite") != 0) && (strcmp(memflag, "writeonly") != 0) && (strcmp(memflag, "readonly") != 0)) {
+    status = napi_throw_error(env, nullptr, "Buffer direction must be one of 'readwrite', 'writeonly' or 'readonly'.");
+    delete c;
+    return nullptr;
+  }
+  eMemFlags memFlags = (0==strcmp("readwrite", memflag)) ? eMemFlags::READWRITE :
+                       (0==strcmp("writeonly", memflag)) ? eMemFlags::WRITEONLY :
+                       eMemFlags::READONLY;
+
+  napi_value svmCapsValue;
+  status = napi_get_named_property(env, contextValue, "svmCaps", &svmCapsValue);
+  CHECK_STATUS;
+  cl_ulong svmCaps;
+  status = napi_get_value_int64(env, svmCapsValue, (int64_t*)&svmCaps);
   CHECK_STATUS;
-  status = napi_get_value_external(env, jsDevInfo, (void**)&devInfo);
+
+  contextExternals ext;
+  status = getContextExternals(env, contextValue, ext);
   CHECK_STATUS;
+  c->numQueues = (uint32_t)ext.commandQueues.size();
+  deviceInfo *devInfo = ext.devInfo;
+
+  if (c->srcBufSize > devInfo->maxAllocBytes) {
+    char errorMsg[200];
+    snprintf(errorMsg, 200, "Buffer size %llu is larger than the device maximum allocation size %llu.",
+      (unsigned long long)c->srcBufSize, (unsigned long long)devInfo->maxAllocBytes);
+    status = napi_throw_range_error(env, nullptr, errorMsg);
+    delete c;
+    return nullptr;
+  }
+
+  // System SVM devices can use any host memory directly. Otherwise the memory can only be used without a copy
+  // when it meets the device base address alignment, so misaligned memory is copied into a pooled allocation.
+  bool systemSVM = 0 != (svmCaps & CL_DEVICE_SVM_FINE_GRAIN_SYSTEM);
+  bool aligned = (0 == devInfo->baseAddrAlign) || (0 == ((uintptr_t)c->srcBuf % devInfo->baseAddrAlign));
 
   status = napi_create_reference(env, contextValue, 1, &c->contextRef);
   CHECK_STATUS;
 
-  // Create holder for host and gpu buffers
-  c->clMem = iClMemory::create(context, commandQueues, memFlags, svmType, numBytes, devInfo, imageDims);
+  if (systemSVM || aligned)
+    c->clMem = iClMemory::wrap(ext.context, ext.commandQueues, memFlags, systemSVM ? eSvmType::FINE : eSvmType::NONE,
+                               c->srcBufSize, devInfo, c->srcBuf, *ext.memPool, *ext.hostCopy);
+  else
+    c->clMem = iClMemory::create(ext.context, ext.commandQueues, memFlags, eSvmType::NONE, c->srcBufSize, devInfo,
+                                 {{0, 0, 0}}, { CL_RGBA, CL_FLOAT }, *ext.memPool, *ext.hostCopy, *ext.staging);
 
-  status = napi_create_reference(env, contextValue, 1, &c->passthru);
+  // hold the source memory until it is wrapped or copied
+  status = napi_create_reference(env, args[0], 1, &c->passthru);
   CHECK_STATUS;
 
   napi_value promise, resource_name;
   status = napi_create_promise(env, &c->_deferred, &promise);
   CHECK_STATUS;
 
-  status = napi_create_string_utf8(env, "CreateBuffer", NAPI_AUTO_LENGTH, &resource_name);
+  status = napi_create_string_utf8(env, "WrapBuffer", NAPI_AUTO_LENGTH, &resource_name);
   CHECK_STATUS;
   status = napi_create_async_work(env, NULL, resource_name, createBufferExecute,
     createBufferComplete, c, &c->_request);
@@ -500,3 +1642,243 @@ napi_value createBuffer(napi_env env, napi_callback_info info) {
 
   return promise;
 }
+
+struct copyBufferCarrier : carrier {
+  iClMemory *srcMem = nullptr;
+  iClMemory *dstMem = nullptr;
+  bool isRect = false;
+  size_t srcOffset = 0;
+  size_t dstOffset = 0;
+  size_t numBytes = 0;
+  std::array<size_t, 3> srcOrigin = {{0, 0, 0}};
+  std::array<size_t, 3> dstOrigin = {{0, 0, 0}};
+  std::array<size_t, 3> region = {{1, 1, 1}};
+  size_t srcRowPitch = 0;
+  size_t srcSlicePitch = 0;
+  size_t dstRowPitch = 0;
+  size_t dstSlicePitch = 0;
+  uint32_t queueNum = 0;
+  cl_command_queue commandQueue = nullptr;
+  bool waitFinish = true;
+};
+
+void copyBufferExecute(napi_env env, void* data) {
+  copyBufferCarrier* c = (copyBufferCarrier*) data;
+  cl_int error;
+
+  HR_TIME_POINT start = NOW;
+
+  if (c->isRect)
+    error = c->srcMem->copyRectTo(c->dstMem, c->srcOrigin, c->dstOrigin, c->region,
+                                  c->srcRowPitch, c->srcSlicePitch, c->dstRowPitch, c->dstSlicePitch, c->queueNum);
+  else
+    error = c->srcMem->copyTo(c->dstMem, c->srcOffset, c->dstOffset, c->numBytes, c->queueNum);
+  ASYNC_CL_ERROR;
+
+  // with overlapping the promise resolves once the copy is enqueued
+  if (c->waitFinish) {
+    error = clFinish(c->commandQueue);
+    ASYNC_CL_ERROR;
+  }
+
+  c->totalTime = microTime(start);
+}
+
+void copyBufferComplete(napi_env env, napi_status asyncStatus, void* data) {
+  copyBufferCarrier* c = (copyBufferCarrier*) data;
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async buffer copy failed to complete.";
+  }
+  REJECT_STATUS;
+
+  napi_value result;
+  c->status = napi_create_object(env, &result);
+  REJECT_STATUS;
+
+  napi_value totalValue;
+  c->status = napi_create_int64(env, (int64_t) c->totalTime, &totalValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "totalTime", totalValue);
+  REJECT_STATUS;
+
+  size_t copyBytes = c->isRect ? c->region[0] * c->region[1] * c->region[2] : c->numBytes;
+  napi_value copyBytesValue;
+  c->status = napi_create_int64(env, (int64_t) copyBytes, &copyBytesValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyBytes", copyBytesValue);
+  REJECT_STATUS;
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+// Offset of the byte after the last byte of a rectangular region, or zero for an empty region
+size_t rectEnd(const std::array<size_t, 3>& origin, const std::array<size_t, 3>& region, size_t rowPitch, size_t slicePitch) {
+  if (0 == region[0] * region[1] * region[2])
+    return 0;
+  return (origin[2] + region[2] - 1) * slicePitch + (origin[1] + region[1] - 1) * rowPitch + origin[0] + region[0];
+}
+
+napi_value copyBuffer(napi_env env, napi_callback_info info) {
+  napi_status status;
+  copyBufferCarrier* c = new copyBufferCarrier;
+
+  napi_value args[3];
+  size_t argc = 3;
+  napi_value contextValue;
+  void *isRect = nullptr;
+  status = napi_get_cb_info(env, info, &argc, args, &contextValue, &isRect);
+  CHECK_STATUS;
+  c->isRect = (nullptr != isRect);
+
+  if (argc < 2) {
+    status = napi_throw_error(env, nullptr, "Wrong number of arguments to copy buffer.");
+    delete c;
+    return nullptr;
+  }
+
+  iClMemory *clMems[2];
+  for (uint32_t i = 0; i < 2; ++i) {
+    bool hasProp = false;
+    napi_valuetype t;
+    status = napi_typeof(env, args[i], &t);
+    CHECK_STATUS;
+    if (t == napi_object) {
+      status = napi_has_named_property(env, args[i], "clMemory", &hasProp);
+      CHECK_STATUS;
+    }
+    if (!hasProp) {
+      status = napi_throw_type_error(env, nullptr, "Source and destination must be OpenCL buffers.");
+      delete c;
+      return nullptr;
+    }
+    napi_value clMemValue;
+    status = napi_get_named_property(env, args[i], "clMemory", &clMemValue);
+    CHECK_STATUS;
+    status = napi_get_value_external(env, clMemValue, (void**)&clMems[i]);
+    CHECK_STATUS;
+  }
+  c->srcMem = clMems[0];
+  c->dstMem = clMems[1];
+
+  napi_value options;
+  if (argc > 2) {
+    napi_valuetype t;
+    status = napi_typeof(env, args[2], &t);
+    CHECK_STATUS;
+    if (t != napi_object) {
+      status = napi_throw_type_error(env, nullptr, "Third argument must be an object - the copy options.");
+      delete c;
+      return nullptr;
+    }
+    options = args[2];
+  } else {
+    status = napi_create_object(env, &options);
+    CHECK_STATUS;
+  }
+
+  uint32_t numQueues;
+  napi_value numQueuesVal;
+  status = napi_get_named_property(env, contextValue, "numQueues", &numQueuesVal);
+  CHECK_STATUS;
+  status = napi_get_value_uint32(env, numQueuesVal, &numQueues);
+  CHECK_STATUS;
+
+  size_t queueNum = 0;
+  bool valid = true;
+  status = getOptionalSize(env, options, "queueNum", queueNum, valid);
+  CHECK_STATUS;
+  if (!valid || (queueNum >= numQueues)) {
+    status = napi_throw_range_error(env, nullptr, "Optional parameter queueNum out of range.");
+    delete c;
+    return nullptr;
+  }
+  c->queueNum = (uint32_t)queueNum;
+  c->waitFinish = (1 == numQueues);
+
+  size_t srcBytes = c->srcMem->numBytes();
+  size_t dstBytes = c->dstMem->numBytes();
+  bool inRange = false;
+  if (c->isRect) {
+    status = getOptionalSize3(env, options, "srcOrigin", c->srcOrigin, valid);
+    CHECK_STATUS;
+    status = getOptionalSize3(env, options, "dstOrigin", c->dstOrigin, valid);
+    CHECK_STATUS;
+    status = getOptionalSize3(env, options, "region", c->region, valid);
+    CHECK_STATUS;
+    status = getOptionalSize(env, options, "srcRowPitch", c->srcRowPitch, valid);
+    CHECK_STATUS;
+    status = getOptionalSize(env, options, "srcSlicePitch", c->srcSlicePitch, valid);
+    CHECK_STATUS;
+    status = getOptionalSize(env, options, "dstRowPitch", c->dstRowPitch, valid);
+    CHECK_STATUS;
+    status = getOptionalSize(env, options, "dstSlicePitch", c->dstSlicePitch, valid);
+    CHECK_STATUS;
+
+    // zero pitches take the OpenCL defaults
+    if (0 == c->srcRowPitch) c->srcRowPitch = c->region[0];
+    if (0 == c->srcSlicePitch) c->srcSlicePitch = c->region[1] * c->srcRowPitch;
+    if (0 == c->dstRowPitch) c->dstRowPitch = c->region[0];
+    if (0 == c->dstSlicePitch) c->dstSlicePitch = c->region[1] * c->dstRowPitch;
+    inRange = (rectEnd(c->srcOrigin, c->region, c->srcRowPitch, c->srcSlicePitch) <= srcBytes) &&
+              (rectEnd(c->dstOrigin, c->region, c->dstRowPitch, c->dstSlicePitch) <= dstBytes);
+  } else {
+    status = getOptionalSize(env, options, "srcOffset", c->srcOffset, valid);
+    CHECK_STATUS;
+    status = getOptionalSize(env, options, "dstOffset", c->dstOffset, valid);
+    CHECK_STATUS;
+    c->numBytes = (c->srcOffset < srcBytes) ? srcBytes - c->srcOffset : 0;
+    if (c->dstOffset < dstBytes)
+      c->numBytes = std::min(c->numBytes, dstBytes - c->dstOffset);
+    status = getOptionalSize(env, options, "bytes", c->numBytes, valid);
+    CHECK_STATUS;
+    inRange = (c->srcOffset + c->numBytes <= srcBytes) && (c->dstOffset + c->numBytes <= dstBytes);
+  }
+  if (!valid) {
+    status = napi_throw_range_error(env, nullptr, "Buffer copy offsets, sizes and pitches cannot be negative.");
+    delete c;
+    return nullptr;
+  }
+  if (!inRange) {
+    status = napi_throw_range_error(env, nullptr, "Buffer copy is outside the source or destination buffer.");
+    delete c;
+    return nullptr;
+  }
+
+  std::stringstream ss;
+  ss << "commands_" << c->queueNum;
+  napi_value commandQueueVal;
+  status = napi_get_named_property(env, contextValue, ss.str().c_str(), &commandQueueVal);
+  CHECK_STATUS;
+  status = napi_get_value_external(env, commandQueueVal, (void**)&c->commandQueue);
+  CHECK_STATUS;
+
+  // hold both buffers until the copy is complete
+  napi_value buffersValue;
+  status = napi_create_array_with_length(env, 2, &buffersValue);
+  CHECK_STATUS;
+  status = napi_set_element(env, buffersValue, 0, args[0]);
+  CHECK_STATUS;
+  status = napi_set_element(env, buffersValue, 1, args[1]);
+  CHECK_STATUS;
+  status = napi_create_reference(env, buffersValue, 1, &c->passthru);
+  CHECK_STATUS;
+
+  napi_value promise, resource_name;
+  status = napi_create_promise(env, &c->_deferred, &promise);
+  CHECK_STATUS;
+
+  status = napi_create_string_utf8(env, "CopyBuffer", NAPI_AUTO_LENGTH, &resource_name);
+  CHECK_STATUS;
+  status = napi_create_async_work(env, NULL, resource_name, copyBufferExecute,
+    copyBufferComplete, c, &c->_request);
+  CHECK_STATUS;
+  status = napi_queue_async_work(env, c->_request);
+  CHECK_STATUS;
+
+  return promise;
+}
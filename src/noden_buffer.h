@@ -19,5 +19,11 @@
 #include "node_api.h"
 
 napi_value createBuffer(napi_env env, napi_callback_info info);
+// Uses the memory of a Node Buffer or ArrayBuffer for OpenCL memory, copying it only when it is misaligned
+napi_value wrapBuffer(napi_env env, napi_callback_info info);
+// Maps many buffers for host access, with any source copies, in one asynchronous work item
+napi_value hostAccessMany(napi_env env, napi_callback_info info);
+// Bound with data true for the rectangular variant
+napi_value copyBuffer(napi_env env, napi_callback_info info);
 
 #endif
@@ -22,7 +22,14 @@
 #include "noden_info.h"
 #include "noden_program.h"
 #include "noden_buffer.h"
+#include "noden_run.h"
+#include "cl_mem_pool.h"
+#include "host_copy.h"
+#include "cl_staging.h"
 #include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <thread>
 
 void finalizeContext(napi_env env, void* data, void* hint) {
   printf("Context finalizer called.\n");
@@ -43,13 +50,225 @@ void finalizeDevInfo(napi_env env, void* data, void* hint) {
   delete (deviceInfo *)data;
 }
 
+void finalizeHostCopy(napi_env env, void* data, void* hint) {
+  printf("Host copy finalizer called.\n");
+  delete (std::shared_ptr<iHostCopy> *)data;
+}
+
+void finalizeStaging(napi_env env, void* data, void* hint) {
+  printf("Staging ring finalizer called.\n");
+  delete (std::shared_ptr<iStagingRing> *)data;
+}
+
+void finalizeMemPool(napi_env env, void* data, void* hint) {
+  printf("Memory pool finalizer called.\n");
+  delete (std::shared_ptr<iClMemPool> *)data;
+}
+
+napi_status getMemPool(napi_env env, napi_value contextValue, std::shared_ptr<iClMemPool> **memPool) {
+  napi_status status;
+  napi_value memPoolValue;
+  status = napi_get_named_property(env, contextValue, "memPool", &memPoolValue);
+  PASS_STATUS;
+  status = napi_get_value_external(env, memPoolValue, (void**)memPool);
+  return status;
+}
+
+napi_value getMemStats(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_value contextValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &contextValue, nullptr);
+  CHECK_STATUS;
+
+  std::shared_ptr<iClMemPool> *memPool;
+  status = getMemPool(env, contextValue, &memPool);
+  CHECK_STATUS;
+  poolStats stats = (*memPool)->stats();
+
+  napi_value result;
+  status = napi_create_object(env, &result);
+  CHECK_STATUS;
+
+  napi_value hitsValue;
+  status = napi_create_int64(env, (int64_t)stats.hits, &hitsValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "poolHits", hitsValue);
+  CHECK_STATUS;
+
+  napi_value missesValue;
+  status = napi_create_int64(env, (int64_t)stats.misses, &missesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "poolMisses", missesValue);
+  CHECK_STATUS;
+
+  napi_value retainedBytesValue;
+  status = napi_create_int64(env, (int64_t)stats.retainedBytes, &retainedBytesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "poolRetainedBytes", retainedBytesValue);
+  CHECK_STATUS;
+
+  napi_value retainedCountValue;
+  status = napi_create_int64(env, (int64_t)stats.retainedCount, &retainedCountValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "poolRetainedCount", retainedCountValue);
+  CHECK_STATUS;
+
+  napi_value maxBytesValue;
+  status = napi_create_int64(env, (int64_t)stats.maxRetainedBytes, &maxBytesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "poolMaxBytes", maxBytesValue);
+  CHECK_STATUS;
+
+  napi_value slabBytesValue;
+  status = napi_create_int64(env, (int64_t)stats.slabBytes, &slabBytesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "slabBytes", slabBytesValue);
+  CHECK_STATUS;
+
+  napi_value slabBlocksValue;
+  status = napi_create_int64(env, (int64_t)stats.slabBlocksInUse, &slabBlocksValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "slabBlocksInUse", slabBlocksValue);
+  CHECK_STATUS;
+
+  napi_value allocatedBytesValue;
+  status = napi_create_int64(env, (int64_t)stats.allocatedBytes, &allocatedBytesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "allocatedBytes", allocatedBytesValue);
+  CHECK_STATUS;
+
+  napi_value peakAllocatedBytesValue;
+  status = napi_create_int64(env, (int64_t)stats.peakAllocatedBytes, &peakAllocatedBytesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "peakAllocatedBytes", peakAllocatedBytesValue);
+  CHECK_STATUS;
+
+  napi_value budgetBytesValue;
+  status = napi_create_int64(env, (int64_t)stats.budgetBytes, &budgetBytesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "budgetBytes", budgetBytesValue);
+  CHECK_STATUS;
+
+  napi_value evictionsValue;
+  status = napi_create_int64(env, (int64_t)stats.evictions, &evictionsValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "evictions", evictionsValue);
+  CHECK_STATUS;
+
+  napi_value pendingReleasesValue;
+  status = napi_create_int64(env, (int64_t)stats.pendingReleases, &pendingReleasesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "pendingReleases", pendingReleasesValue);
+  CHECK_STATUS;
+
+  napi_value pendingReleaseBytesValue;
+  status = napi_create_int64(env, (int64_t)stats.pendingReleaseBytes, &pendingReleaseBytesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "pendingReleaseBytes", pendingReleaseBytesValue);
+  CHECK_STATUS;
+
+  napi_value jsDevInfo;
+  deviceInfo *devInfo;
+  status = napi_get_named_property(env, contextValue, "deviceInfo", &jsDevInfo);
+  CHECK_STATUS;
+  status = napi_get_value_external(env, jsDevInfo, (void**)&devInfo);
+  CHECK_STATUS;
+
+  napi_value copiesToImageValue;
+  status = napi_create_int64(env, (int64_t)devInfo->imageCopiesToImage.load(), &copiesToImageValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "imageCopiesToImage", copiesToImageValue);
+  CHECK_STATUS;
+
+  napi_value copiesToBufferValue;
+  status = napi_create_int64(env, (int64_t)devInfo->imageCopiesToBuffer.load(), &copiesToBufferValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "imageCopiesToBuffer", copiesToBufferValue);
+  CHECK_STATUS;
+
+  napi_value copyBytesValue;
+  status = napi_create_int64(env, (int64_t)devInfo->imageCopyBytes.load(), &copyBytesValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "imageCopyBytes", copyBytesValue);
+  CHECK_STATUS;
+
+  return result;
+}
+
+struct trimPoolCarrier : carrier {
+  std::shared_ptr<iClMemPool> memPool;
+  uint64_t trimmedBytes = 0;
+};
+
+// Trimming waits for pending releases to complete, so it runs off the Javascript thread
+void trimPoolExecute(napi_env env, void* data) {
+  trimPoolCarrier* c = (trimPoolCarrier*) data;
+  c->trimmedBytes = c->memPool->trim();
+}
+
+void trimPoolComplete(napi_env env, napi_status asyncStatus, void* data) {
+  trimPoolCarrier* c = (trimPoolCarrier*) data;
+  napi_value result;
+
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async memory pool trim failed to complete.";
+  }
+  REJECT_STATUS;
+
+  c->status = napi_create_int64(env, (int64_t)c->trimmedBytes, &result);
+  REJECT_STATUS;
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+napi_value trimPool(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_value promise;
+  napi_value resource_name;
+  napi_value contextValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &contextValue, nullptr);
+  CHECK_STATUS;
+
+  std::shared_ptr<iClMemPool> *memPool;
+  status = getMemPool(env, contextValue, &memPool);
+  CHECK_STATUS;
+
+  trimPoolCarrier* c = new trimPoolCarrier;
+  c->memPool = *memPool;
+
+  status = napi_create_reference(env, contextValue, 1, &c->passthru);
+  CHECK_STATUS;
+  status = napi_create_promise(env, &c->_deferred, &promise);
+  CHECK_STATUS;
+
+  status = napi_create_string_utf8(env, "TrimPool", NAPI_AUTO_LENGTH, &resource_name);
+  CHECK_STATUS;
+  status = napi_create_async_work(env, NULL, resource_name, trimPoolExecute,
+    trimPoolComplete, c, &c->_request);
+  CHECK_STATUS;
+  status = napi_queue_async_work(env, c->_request);
+  CHECK_STATUS;
+
+  return promise;
+}
+
 struct waitFinishCarrier : carrier {
   cl_command_queue commandQueue;
 };
 
 void waitFinishExecute(napi_env env, void* data) {
   waitFinishCarrier* c = (waitFinishCarrier*) data;
-  cl_int error = clFinish(c->commandQueue);
+  cl_event finished;
+  cl_int error = clEnqueueMarkerWithWaitList(c->commandQueue, 0, nullptr, &finished);
+  ASYNC_CL_ERROR;
+  c->completeEvents.push_back(finished);
+  c->waitStart = NOW;
+  error = clFlush(c->commandQueue);
   ASYNC_CL_ERROR;
 }
 
@@ -61,6 +280,7 @@ void waitFinishComplete(napi_env env, napi_status asyncStatus, void* data) {
     c->status = asyncStatus;
     c->errorMsg = "Async wait for finish failed to complete.";
   }
+  if (deferComplete(env, c, waitFinishComplete)) return;
   REJECT_STATUS;
 
   c->status = napi_get_undefined(env, &result);
@@ -164,6 +384,48 @@ void createContextExecute(napi_env env, void* data) {
   ASYNC_CL_ERROR;
   c->deviceVersion = std::string(version);
 
+  cl_ulong globalMemSize = 0;
+  error = clGetDeviceInfo(c->deviceId, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &globalMemSize, nullptr);
+  ASYNC_CL_ERROR;
+  if (!c->hasPoolMaxBytes)
+    c->poolMaxBytes = globalMemSize / 4;
+  if (!c->hasMemBudgetBytes)
+    c->memBudgetBytes = globalMemSize;
+
+  cl_uint baseAddrAlignBits = 0;
+  error = clGetDeviceInfo(c->deviceId, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(cl_uint), &baseAddrAlignBits, nullptr);
+  ASYNC_CL_ERROR;
+  c->baseAddrAlign = baseAddrAlignBits / 8;
+
+  cl_ulong maxAllocBytes = 0;
+  error = clGetDeviceInfo(c->deviceId, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &maxAllocBytes, nullptr);
+  ASYNC_CL_ERROR;
+  c->maxAllocBytes = maxAllocBytes;
+
+  cl_bool hostUnifiedMemory = CL_FALSE;
+  error = clGetDeviceInfo(c->deviceId, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &hostUnifiedMemory, nullptr);
+  ASYNC_CL_ERROR;
+  c->unifiedMemory = c->allowUnifiedMemory && (CL_TRUE == hostUnifiedMemory);
+
+  size_t extensionsSize = 0;
+  error = clGetDeviceInfo(c->deviceId, CL_DEVICE_EXTENSIONS, 0, nullptr, &extensionsSize);
+  ASYNC_CL_ERROR;
+  std::vector<char> extensions(extensionsSize + 1, 0);
+  error = clGetDeviceInfo(c->deviceId, CL_DEVICE_EXTENSIONS, extensionsSize, extensions.data(), nullptr);
+  ASYNC_CL_ERROR;
+  c->imageFromBuffer = (clVersion(c->deviceVersion) >= clVersion(2,0)) ||
+                       (nullptr != strstr(extensions.data(), "cl_khr_image2d_from_buffer"));
+  if (c->imageFromBuffer) {
+    cl_uint pitchAlign = 0;
+    error = clGetDeviceInfo(c->deviceId, CL_DEVICE_IMAGE_PITCH_ALIGNMENT, sizeof(cl_uint), &pitchAlign, nullptr);
+    ASYNC_CL_ERROR;
+    c->imagePitchAlign = pitchAlign;
+    cl_uint imageBaseAddrAlign = 0;
+    error = clGetDeviceInfo(c->deviceId, CL_DEVICE_IMAGE_BASE_ADDRESS_ALIGNMENT, sizeof(cl_uint), &imageBaseAddrAlign, nullptr);
+    ASYNC_CL_ERROR;
+    c->imageBaseAddrAlign = imageBaseAddrAlign;
+  }
+
   c->totalTime = microTime(start);
 }
 
@@ -205,12 +467,49 @@ void createContextComplete(napi_env env, napi_status asyncStatus, void* data) {
   }
 
   deviceInfo *devInfo = new deviceInfo(clVersion(c->deviceVersion));
+  devInfo->maxAllocBytes = c->maxAllocBytes;
+  devInfo->baseAddrAlign = c->baseAddrAlign;
+  devInfo->unifiedMemory = c->unifiedMemory;
+  devInfo->imageFromBuffer = c->imageFromBuffer;
+  devInfo->imagePitchAlign = c->imagePitchAlign;
+  devInfo->imageBaseAddrAlign = c->imageBaseAddrAlign;
   napi_value deviceInfoValue;
   c->status = napi_create_external(env, devInfo, finalizeDevInfo, nullptr, &deviceInfoValue);
   REJECT_STATUS;
   c->status = napi_set_named_property(env, result, "deviceInfo", deviceInfoValue);
   REJECT_STATUS;
 
+  napi_value unifiedMemoryValue;
+  c->status = napi_get_boolean(env, c->unifiedMemory, &unifiedMemoryValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "unifiedMemory", unifiedMemoryValue);
+  REJECT_STATUS;
+
+  std::shared_ptr<iClMemPool> *memPool = new std::shared_ptr<iClMemPool>(
+    iClMemPool::create(c->context, c->poolMaxBytes, c->slabMaxBytes, c->baseAddrAlign,
+                       c->maxAllocBytes, c->memBudgetBytes));
+  napi_value memPoolValue;
+  c->status = napi_create_external(env, memPool, finalizeMemPool, nullptr, &memPoolValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "memPool", memPoolValue);
+  REJECT_STATUS;
+
+  std::shared_ptr<iHostCopy> *hostCopy = new std::shared_ptr<iHostCopy>(
+    iHostCopy::create(c->copyThreads, c->copyMinBytes, c->copyChunkBytes));
+  napi_value hostCopyValue;
+  c->status = napi_create_external(env, hostCopy, finalizeHostCopy, nullptr, &hostCopyValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "hostCopy", hostCopyValue);
+  REJECT_STATUS;
+
+  std::shared_ptr<iStagingRing> *staging = new std::shared_ptr<iStagingRing>(
+    iStagingRing::create(c->context, c->stagingSlots, c->stagingChunkBytes));
+  napi_value stagingValue;
+  c->status = napi_create_external(env, staging, finalizeStaging, nullptr, &stagingValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "staging", stagingValue);
+  REJECT_STATUS;
+
   napi_value createProgramValue;
   c->status = napi_create_function(env, "createProgram", NAPI_AUTO_LENGTH,
     createProgram, nullptr, &createProgramValue);
@@ -225,6 +524,41 @@ void createContextComplete(napi_env env, napi_status asyncStatus, void* data) {
   c->status = napi_set_named_property(env, result, "createBuffer", createBufValue);
   REJECT_STATUS;
 
+  napi_value wrapBufValue;
+  c->status = napi_create_function(env, "wrapBuffer", NAPI_AUTO_LENGTH,
+    wrapBuffer, nullptr, &wrapBufValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "wrapBuffer", wrapBufValue);
+  REJECT_STATUS;
+
+  napi_value copyBufferValue;
+  c->status = napi_create_function(env, "copyBuffer", NAPI_AUTO_LENGTH,
+    copyBuffer, (void*)false, &copyBufferValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyBuffer", copyBufferValue);
+  REJECT_STATUS;
+
+  napi_value copyBufferRectValue;
+  c->status = napi_create_function(env, "copyBufferRect", NAPI_AUTO_LENGTH,
+    copyBuffer, (void*)true, &copyBufferRectValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "copyBufferRect", copyBufferRectValue);
+  REJECT_STATUS;
+
+  napi_value hostAccessManyValue;
+  c->status = napi_create_function(env, "hostAccessMany", NAPI_AUTO_LENGTH,
+    hostAccessMany, nullptr, &hostAccessManyValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "hostAccessMany", hostAccessManyValue);
+  REJECT_STATUS;
+
+  napi_value runManyValue;
+  c->status = napi_create_function(env, "runMany", NAPI_AUTO_LENGTH,
+    runMany, nullptr, &runManyValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "runMany", runManyValue);
+  REJECT_STATUS;
+
   napi_value waitFinishValue;
   c->status = napi_create_function(env, "waitFinish", NAPI_AUTO_LENGTH,
     waitFinish, nullptr, &waitFinishValue);
@@ -232,6 +566,20 @@ void createContextComplete(napi_env env, napi_status asyncStatus, void* data) {
   c->status = napi_set_named_property(env, result, "waitFinish", waitFinishValue);
   REJECT_STATUS;
 
+  napi_value getMemStatsValue;
+  c->status = napi_create_function(env, "getMemStats", NAPI_AUTO_LENGTH,
+    getMemStats, nullptr, &getMemStatsValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "getMemStats", getMemStatsValue);
+  REJECT_STATUS;
+
+  napi_value trimPoolValue;
+  c->status = napi_create_function(env, "trimPool", NAPI_AUTO_LENGTH,
+    trimPool, nullptr, &trimPoolValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "trimPool", trimPoolValue);
+  REJECT_STATUS;
+
   napi_status status;
   status = napi_resolve_deferred(env, c->_deferred, result);
   FLOATING_STATUS;
@@ -239,6 +587,48 @@ void createContextComplete(napi_env env, napi_status asyncStatus, void* data) {
   tidyCarrier(env, c);
 }
 
+// Reads an optional numeric configuration property. Returns false with an exception pending
+// if the property is present but is not a number in the range minValue to maxValue.
+bool getConfigInt64(napi_env env, napi_value config, const char* name, int64_t minValue, int64_t maxValue,
+                    bool& hasValue, int64_t& value) {
+  napi_status status;
+  hasValue = false;
+  bool hasProp;
+  status = napi_has_named_property(env, config, name, &hasProp);
+  CHECK_BAIL;
+  if (!hasProp)
+    return true;
+
+  napi_value propValue;
+  status = napi_get_named_property(env, config, name, &propValue);
+  CHECK_BAIL;
+  napi_valuetype t;
+  status = napi_typeof(env, propValue, &t);
+  CHECK_BAIL;
+  if (t == napi_undefined)
+    return true;
+
+  char errorMsg[200];
+  if (t != napi_number) {
+    snprintf(errorMsg, 200, "Configuration parameter %s must be a number.", name);
+    napi_throw_type_error(env, nullptr, errorMsg);
+    return false;
+  }
+  status = napi_get_value_int64(env, propValue, &value);
+  CHECK_BAIL;
+  if ((value < minValue) || (value > maxValue)) {
+    if (INT64_MAX == maxValue)
+      snprintf(errorMsg, 200, "Optional configuration parameter %s must be at least %lld.", name, (long long)minValue);
+    else
+      snprintf(errorMsg, 200, "Optional configuration parameter %s must be between %lld and %lld.",
+        name, (long long)minValue, (long long)maxValue);
+    napi_throw_range_error(env, nullptr, errorMsg);
+    return false;
+  }
+  hasValue = true;
+  return true;
+}
+
 napi_value createContext(napi_env env, napi_callback_info info) {
   napi_status status;
   createContextCarrier* carrier = new createContextCarrier;
@@ -351,6 +741,8 @@ napi_value createContext(napi_env env, napi_callback_info info) {
     return nullptr;
   }
 
+  carrier->copyThreads = std::min(std::max(std::thread::hardware_concurrency() / 2, 1U), 4U);
+
   carrier->platformId = platformIds[platformIndex];
   carrier->deviceId = deviceIds[deviceIndex];
 
@@ -381,6 +773,66 @@ napi_value createContext(napi_env env, napi_callback_info info) {
     CHECK_STATUS;
   }
 
+  int64_t configValue;
+  if (!getConfigInt64(env, config, "poolMaxBytes", 0, INT64_MAX, carrier->hasPoolMaxBytes, configValue))
+    return nullptr;
+  if (carrier->hasPoolMaxBytes)
+    carrier->poolMaxBytes = (uint64_t)configValue;
+
+  status = napi_has_named_property(env, config, "unifiedMemory", &hasProp);
+  CHECK_STATUS;
+  if (hasProp) {
+    napi_value unifiedMemoryValue;
+    status = napi_get_named_property(env, config, "unifiedMemory", &unifiedMemoryValue);
+    CHECK_STATUS;
+    status = napi_typeof(env, unifiedMemoryValue, &t);
+    CHECK_STATUS;
+    if (t != napi_undefined) {
+      if (t != napi_boolean) {
+        status = napi_throw_type_error(env, nullptr, "Configuration parameter unifiedMemory must be a boolean.");
+        return nullptr;
+      }
+      status = napi_get_value_bool(env, unifiedMemoryValue, &carrier->allowUnifiedMemory);
+      CHECK_STATUS;
+    }
+  }
+
+  if (!getConfigInt64(env, config, "memBudgetBytes", 0, INT64_MAX, carrier->hasMemBudgetBytes, configValue))
+    return nullptr;
+  if (carrier->hasMemBudgetBytes)
+    carrier->memBudgetBytes = (uint64_t)configValue;
+
+  bool hasConfigValue;
+  if (!getConfigInt64(env, config, "slabMaxBytes", 0, 1048576, hasConfigValue, configValue))
+    return nullptr;
+  if (hasConfigValue)
+    carrier->slabMaxBytes = (uint64_t)configValue;
+
+  if (!getConfigInt64(env, config, "copyThreads", 1, 64, hasConfigValue, configValue))
+    return nullptr;
+  if (hasConfigValue)
+    carrier->copyThreads = (uint32_t)configValue;
+
+  if (!getConfigInt64(env, config, "copyMinBytes", 0, INT64_MAX, hasConfigValue, configValue))
+    return nullptr;
+  if (hasConfigValue)
+    carrier->copyMinBytes = (uint64_t)configValue;
+
+  if (!getConfigInt64(env, config, "copyChunkBytes", 4096, INT64_MAX, hasConfigValue, configValue))
+    return nullptr;
+  if (hasConfigValue)
+    carrier->copyChunkBytes = (uint64_t)configValue;
+
+  if (!getConfigInt64(env, config, "stagingSlots", 2, 64, hasConfigValue, configValue))
+    return nullptr;
+  if (hasConfigValue)
+    carrier->stagingSlots = (uint32_t)configValue;
+
+  if (!getConfigInt64(env, config, "stagingChunkBytes", 4096, INT64_MAX, hasConfigValue, configValue))
+    return nullptr;
+  if (hasConfigValue)
+    carrier->stagingChunkBytes = (uint64_t)configValue;
+
   cl_ulong svmCaps;
   error = clGetDeviceInfo(carrier->deviceId, CL_DEVICE_SVM_CAPABILITIES, sizeof(cl_ulong), &svmCaps, nullptr);
   if (error == CL_INVALID_VALUE) {
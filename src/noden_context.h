@@ -24,9 +24,13 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <map>
 #include <tuple>
+#include <atomic>
+#include <mutex>
 #include "node_api.h"
 #include "noden_util.h"
+#include "cl_memory.h"
 
 class clVersion {
   public:
@@ -60,8 +64,29 @@ class clVersion {
 
 struct deviceInfo {
   clVersion oclVer;
-
-  deviceInfo(const clVersion& v) : oclVer(v) {}
+  // Supported image formats, queried on first use for each combination of memory flags and image type
+  std::map<std::pair<uint64_t, uint32_t>, std::vector<cl_image_format> > imageFormats;
+  uint64_t maxAllocBytes = 0;
+  uint32_t baseAddrAlign = 0; // bytes
+  // Host and device share memory, so fine-grained SVM buffers stay mapped and buffers of SVM type none are
+  // mapped whole for host access, reusing the mapping until the next kernel use
+  bool unifiedMemory = false;
+  // 2D images can be created over a buffer - OpenCL 2.0 or cl_khr_image2d_from_buffer
+  bool imageFromBuffer = false;
+  uint32_t imagePitchAlign = 0; // pixels
+  uint32_t imageBaseAddrAlign = 0; // pixels
+
+  // Implicit copies made to keep images and buffers in sync when an image cannot share the buffer memory
+  std::atomic<uint64_t> imageCopiesToImage;
+  std::atomic<uint64_t> imageCopiesToBuffer;
+  std::atomic<uint64_t> imageCopyBytes;
+
+  // Buffer types measured to be fastest for bufType 'auto', by allocation size class
+  std::map<size_t, eSvmType> autoSvmTypes;
+  std::mutex autoSvmMutex;
+
+  deviceInfo(const clVersion& v)
+    : oclVer(v), imageCopiesToImage(0), imageCopiesToBuffer(0), imageCopyBytes(0) {}
 };
 
 struct createContextCarrier : carrier {
@@ -71,6 +96,24 @@ struct createContextCarrier : carrier {
   uint32_t numQueues;
   std::vector<cl_command_queue> commandQueues;
   std::string deviceVersion;
+  bool hasPoolMaxBytes = false;
+  uint64_t poolMaxBytes = 0;
+  uint64_t slabMaxBytes = 16384;
+  bool hasMemBudgetBytes = false;
+  uint64_t memBudgetBytes = 0;
+  uint32_t baseAddrAlign = 0;
+  uint64_t maxAllocBytes = 0;
+  bool allowUnifiedMemory = true;
+  bool unifiedMemory = false;
+  // 2D images can be created over a buffer - OpenCL 2.0 or cl_khr_image2d_from_buffer
+  bool imageFromBuffer = false;
+  uint32_t imagePitchAlign = 0;
+  uint32_t imageBaseAddrAlign = 0;
+  uint32_t copyThreads = 4;
+  uint64_t copyMinBytes = 1048576;
+  uint64_t copyChunkBytes = 262144;
+  uint32_t stagingSlots = 4;
+  uint64_t stagingChunkBytes = 1048576;
 };
 
 napi_value createContext(napi_env env, napi_callback_info info);
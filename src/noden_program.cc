@@ -19,18 +19,65 @@
 #include <regex>
 #include <sstream>
 
+argTypeDesc classifyArgType(const std::string& typeName, uint32_t addressBits) {
+  static const struct { const char *name; eArgElemType elemType; uint8_t elemBytes; } scalarTypes[] = {
+    { "char", eArgElemType::CHAR, 1 }, { "uchar", eArgElemType::UCHAR, 1 },
+    { "short", eArgElemType::SHORT, 2 }, { "ushort", eArgElemType::USHORT, 2 },
+    { "int", eArgElemType::INT, 4 }, { "uint", eArgElemType::UINT, 4 },
+    { "long", eArgElemType::LONG, 8 }, { "ulong", eArgElemType::ULONG, 8 },
+    { "half", eArgElemType::HALF, 2 }, { "float", eArgElemType::FLOAT, 4 }, { "double", eArgElemType::DOUBLE, 8 }
+  };
+
+  argTypeDesc desc;
+  bool wide = addressBits > 32;
+  if ((0 == typeName.compare("size_t")) || (0 == typeName.compare("uintptr_t"))) {
+    desc.elemType = wide ? eArgElemType::ULONG : eArgElemType::UINT;
+    desc.numElements = 1;
+    desc.numBytes = wide ? 8 : 4;
+    return desc;
+  }
+  if ((0 == typeName.compare("ptrdiff_t")) || (0 == typeName.compare("intptr_t"))) {
+    desc.elemType = wide ? eArgElemType::LONG : eArgElemType::INT;
+    desc.numElements = 1;
+    desc.numBytes = wide ? 8 : 4;
+    return desc;
+  }
+
+  // a vector type is the element type name followed by the number of components
+  size_t digitsPos = typeName.find_last_not_of("0123456789") + 1;
+  std::string baseName = typeName.substr(0, digitsPos);
+  uint32_t numElements = (digitsPos < typeName.length()) ? (uint32_t)std::stoul(typeName.substr(digitsPos)) : 1;
+  if (!((1 == numElements) || (2 == numElements) || (3 == numElements) || (4 == numElements) ||
+        (8 == numElements) || (16 == numElements)))
+    return desc;
+
+  for (auto& scalarType: scalarTypes) {
+    if (0 == baseName.compare(scalarType.name)) {
+      desc.elemType = scalarType.elemType;
+      desc.numElements = (uint8_t)numElements;
+      desc.numBytes = (uint16_t)(scalarType.elemBytes * (3 == numElements ? 4 : numElements));
+      break;
+    }
+  }
+  return desc;
+}
+
 class kernelArg : public iKernelArg {
   public:
-    kernelArg(const std::string& name, const std::string& type, eAccess access)
-      : mName(name), mType(type), mAccess(access) {}
+    kernelArg(const std::string& name, const std::string& type, eAccess access, eAddress address,
+              const argTypeDesc& typeDesc)
+      : mName(name), mType(type), mAccess(access), mAddress(address), mTypeDesc(typeDesc) {}
     ~kernelArg() {}
 
     std::string name() const { return mName; }
     std::string type() const { return mType; }
     eAccess access() const { return mAccess; }
+    eAddress address() const { return mAddress; }
+    const argTypeDesc& typeDesc() const { return mTypeDesc; }
 
     std::string toString() const {
-      return mType + " " + mName + (eAccess::READONLY == mAccess ? " readonly" :
+      return (eAddress::LOCAL == mAddress ? "local " : "") +
+             mType + " " + mName + (eAccess::READONLY == mAccess ? " readonly" :
                                     eAccess::WRITEONLY == mAccess ? " writeonly" : 
                                     "");
     }
@@ -39,18 +86,24 @@ class kernelArg : public iKernelArg {
     const std::string mName;
     const std::string mType;
     const eAccess mAccess;
+    const eAddress mAddress;
+    const argTypeDesc mTypeDesc;
 };
 
 class runParams : public iRunParams {
 public:
-  runParams(const std::vector<size_t>& gwi, const std::vector<size_t>& wig, const tKernelArgMap& kernelArgMap) :
-    mGlobalWorkItems(gwi), mWorkItemsPerGroup(wig), mKernelArgMap(kernelArgMap) {}
+  runParams(const std::vector<size_t>& gwi, const std::vector<size_t>& wig, const tKernelArgMap& kernelArgMap,
+            uint64_t kernelLocalMemSize, uint64_t deviceLocalMemSize) :
+    mGlobalWorkItems(gwi), mWorkItemsPerGroup(wig), mKernelArgMap(kernelArgMap),
+    mKernelLocalMemSize(kernelLocalMemSize), mDeviceLocalMemSize(deviceLocalMemSize) {}
   ~runParams() {}
 
   size_t numDims() const { return mGlobalWorkItems.size(); }
   const size_t *globalWorkItems() const { return mGlobalWorkItems.data(); }
   const size_t *workItemsPerGroup() const { return mWorkItemsPerGroup.data(); }
-  const tKernelArgMap kernelArgMap() const { return mKernelArgMap; }
+  const tKernelArgMap& kernelArgMap() const { return mKernelArgMap; }
+  uint64_t kernelLocalMemSize() const { return mKernelLocalMemSize; }
+  uint64_t deviceLocalMemSize() const { return mDeviceLocalMemSize; }
 
   void argDebug(const std::string& kernelName) const {
     printf("%s (\n", kernelName.c_str());
@@ -66,6 +119,8 @@ private:
   const std::vector<size_t> mGlobalWorkItems;
   const std::vector<size_t> mWorkItemsPerGroup;
   const tKernelArgMap mKernelArgMap;
+  const uint64_t mKernelLocalMemSize;
+  const uint64_t mDeviceLocalMemSize;
 };
 
 void tidyProgram(napi_env env, void* data, void* hint) {
@@ -181,6 +236,20 @@ void buildExecute(napi_env env, void* data) {
   error = clGetKernelInfo(c->kernel, CL_KERNEL_NUM_ARGS, sizeof(numArgs), &numArgs, NULL);
   ASYNC_CL_ERROR;
 
+  cl_uint addressBits = 0;
+  error = clGetDeviceInfo(c->deviceId, CL_DEVICE_ADDRESS_BITS, sizeof(addressBits), &addressBits, nullptr);
+  ASYNC_CL_ERROR;
+
+  // queried before any arguments are set, so this is the local memory the kernel declares for itself
+  cl_ulong kernelLocalMemSize = 0;
+  error = clGetKernelWorkGroupInfo(c->kernel, c->deviceId, CL_KERNEL_LOCAL_MEM_SIZE,
+    sizeof(kernelLocalMemSize), &kernelLocalMemSize, nullptr);
+  ASYNC_CL_ERROR;
+
+  cl_ulong deviceLocalMemSize = 0;
+  error = clGetDeviceInfo(c->deviceId, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(deviceLocalMemSize), &deviceLocalMemSize, nullptr);
+  ASYNC_CL_ERROR;
+
   tKernelArgMap kernelArgMap;
   for (cl_uint p=0; p<numArgs; ++p) {
     std::string argName;
@@ -197,10 +266,19 @@ void buildExecute(napi_env env, void* data) {
     kernelArg::eAccess argAccess(CL_KERNEL_ARG_ACCESS_READ_ONLY == accessQualifier ? kernelArg::eAccess::READONLY :
                                  CL_KERNEL_ARG_ACCESS_WRITE_ONLY == accessQualifier ? kernelArg::eAccess::WRITEONLY :
                                  kernelArg::eAccess::NONE);
-    kernelArg *ka = new kernelArg(argName, argType, argAccess);
+
+    cl_kernel_arg_address_qualifier addressQualifier;
+    error = clGetKernelArgInfo(c->kernel, p, CL_KERNEL_ARG_ADDRESS_QUALIFIER, sizeof(addressQualifier), &addressQualifier, NULL);
+    ASYNC_CL_ERROR;
+    kernelArg::eAddress argAddress(CL_KERNEL_ARG_ADDRESS_GLOBAL == addressQualifier ? kernelArg::eAddress::GLOBAL :
+                                   CL_KERNEL_ARG_ADDRESS_CONSTANT == addressQualifier ? kernelArg::eAddress::CONSTANT :
+                                   CL_KERNEL_ARG_ADDRESS_LOCAL == addressQualifier ? kernelArg::eAddress::LOCAL :
+                                   kernelArg::eAddress::PRIVATE);
+    kernelArg *ka = new kernelArg(argName, argType, argAccess, argAddress, classifyArgType(argType, addressBits));
     kernelArgMap.emplace(p, ka);
   }
-  c->runParams = new runParams(c->globalWorkItems, c->workItemsPerGroup, kernelArgMap);
+  c->runParams = new runParams(c->globalWorkItems, c->workItemsPerGroup, kernelArgMap,
+                               kernelLocalMemSize, deviceLocalMemSize);
 
   c->totalTime = microTime(start);
 }
@@ -255,6 +333,13 @@ void buildComplete(napi_env env, napi_status asyncStatus, void* data) {
   c->status = napi_set_named_property(env, result, "run", runValue);
   REJECT_STATUS;
 
+  napi_value bindValue;
+  c->status = napi_create_function(env, "bind", NAPI_AUTO_LENGTH, bind,
+    nullptr, &bindValue);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "bind", bindValue);
+  REJECT_STATUS;
+
   napi_status status;
   status = napi_resolve_deferred(env, c->_deferred, result);
   FLOATING_STATUS;
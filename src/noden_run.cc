@@ -16,6 +16,53 @@
 #include "noden_run.h"
 #include "cl_memory.h"
 #include "sstream"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <climits>
+
+// OpenCL image object type for a kernel argument type name, 0 if it is not an image type
+cl_mem_object_type imageObjectType(const std::string& argType) {
+  if (0 == argType.compare("image2d_t")) return CL_MEM_OBJECT_IMAGE2D;
+  if (0 == argType.compare("image3d_t")) return CL_MEM_OBJECT_IMAGE3D;
+  if (0 == argType.compare("image2d_array_t")) return CL_MEM_OBJECT_IMAGE2D_ARRAY;
+  if (0 == argType.compare("image1d_t")) return CL_MEM_OBJECT_IMAGE1D;
+  if (0 == argType.compare("image1d_array_t")) return CL_MEM_OBJECT_IMAGE1D_ARRAY;
+  if (0 == argType.compare("image1d_buffer_t")) return CL_MEM_OBJECT_IMAGE1D_BUFFER;
+  return 0;
+}
+
+// Sets every argument of the kernel from the resolved parameters, making buffers available to the device on the queue
+cl_int setKernelArgs(runArgs& ra, uint32_t queueNum) {
+  cl_int error = CL_SUCCESS;
+  for (uint32_t p = 0; p < (uint32_t)ra.kernelParams.size(); ++p) {
+    kernelParam& param = ra.kernelParams[p];
+    if ((eParamFlags::BUFFER == param.valueType) || (eParamFlags::IMAGE == param.valueType)) {
+      error = param.gpuAccess->setKernelParam(ra.kernel, p, param.imageType, param.access, queueNum);
+      PASS_CL_ERROR;
+      param.gpuAccess.reset();
+    }
+  }
+
+  for (uint32_t p = 0; p < (uint32_t)ra.kernelParams.size(); ++p) {
+    kernelParam& param = ra.kernelParams[p];
+    if (eParamFlags::VALUE == param.valueType) {
+      error = clSetKernelArg(ra.kernel, p, param.typeDesc.numBytes, param.value.bytes);
+      PASS_CL_ERROR;
+    } else if (eParamFlags::LOCAL == param.valueType) {
+      error = clSetKernelArg(ra.kernel, p, (size_t)param.value.localBytes, nullptr);
+      PASS_CL_ERROR;
+    }
+  }
+  return error;
+}
+
+void getGPUMemory(runArgs& ra) {
+  for (auto& param: ra.kernelParams) {
+    if ((eParamFlags::BUFFER == param.valueType) || (eParamFlags::IMAGE == param.valueType))
+      param.gpuAccess = param.value.clMem->getGPUMemory();
+  }
+}
 
 void runExecute(napi_env env, void* data) {
   runCarrier* c = (runCarrier*) data;
@@ -23,42 +70,14 @@ void runExecute(napi_env env, void* data) {
   // HR_TIME_POINT bufAlloc = NOW;
   // Not recording buffer create time - should probably be done once, before here
 
-  for (auto& paramIter: c->kernelParams) {
-    kernelParam* param = paramIter.second;
-    if (eParamFlags::VALUE != param->valueType)
-      param->gpuAccess = param->value.clMem->getGPUMemory();
-  }
+  getGPUMemory(*c);
   
   // printf("Took %lluus to create GPU buffers.\n", microTime(bufAlloc));
   HR_TIME_POINT start = NOW;
   HR_TIME_POINT dataToKernelStart = start;
 
-  for (auto& paramIter: c->kernelParams) {
-    uint32_t p = paramIter.first;
-    kernelParam* param = paramIter.second;
-    if (eParamFlags::VALUE != param->valueType) {
-      error = param->gpuAccess->setKernelParam(c->kernel, p, eParamFlags::IMAGE == param->valueType, 
-                                               param->access, c->runParams, c->queueNum);
-      ASYNC_CL_ERROR;
-      param->gpuAccess.reset();
-    }
-  }
-
-  for (auto& paramIter: c->kernelParams) {
-    uint32_t p = paramIter.first;
-    kernelParam* param = paramIter.second;
-    if (0 == param->paramType.compare("uint"))
-      error = clSetKernelArg(c->kernel, p, sizeof(uint32_t), &param->value.uint32);
-    else if (0 == param->paramType.compare("int"))
-      error = clSetKernelArg(c->kernel, p, sizeof(int32_t), &param->value.int32);
-    else if (0 == param->paramType.compare("long"))
-      error = clSetKernelArg(c->kernel, p, sizeof(int64_t), &param->value.int64);
-    else if (0 == param->paramType.compare("float"))
-      error = clSetKernelArg(c->kernel, p, sizeof(float), &param->value.flt);
-    else if (0 == param->paramType.compare("double"))
-      error = clSetKernelArg(c->kernel, p, sizeof(double), &param->value.dbl);
-    ASYNC_CL_ERROR;
-  }
+  error = setKernelArgs(*c, c->queueNum);
+  ASYNC_CL_ERROR;
 
   uint32_t q = c->queueNum;
   if (q >= (uint32_t)c->commandQueues.size()) {
@@ -76,23 +95,26 @@ void runExecute(napi_env env, void* data) {
   error = clEnqueueNDRangeKernel(commandQueue, c->kernel, numDims, nullptr, global, local, 0, nullptr, nullptr);
   ASYNC_CL_ERROR;
 
-  if (1 == c->commandQueues.size()) {
-    error = clFinish(commandQueue);
-    ASYNC_CL_ERROR;
-  }
-
   c->kernelExec = microTime(kernelExecStart);
   HR_TIME_POINT dataFromKernelStart = NOW;
 
-  // set host readonly access for any buffers that are declared writeonly for the kernel
-  // for (auto& paramIter: c->kernelParams) {
-  //   uint32_t p = paramIter.first;
-  //   kernelParam* param = paramIter.second;
-  //   if ((eParamFlags::VALUE != param->valueType) && (eMemFlags::WRITEONLY == param->value.clMem->memFlags())) {
-  //     param->value.clMem->setHostAccess(error, eMemFlags::READONLY, c->queueNum);
-  //     ASYNC_CL_ERROR;
-  //   }
-  // }
+  // set host readonly access for the requested outputs on the queue that ran the kernel, waiting once for them all
+  for (auto p: c->readback) {
+    iClMemory *clMem = c->kernelParams.at(p).value.clMem;
+    error = clMem->setHostAccess(eMemFlags::READONLY, q, 0, clMem->numBytes(), false);
+    ASYNC_CL_ERROR;
+  }
+
+  // the promise resolves from the completion of a marker rather than a worker thread waiting for the queue
+  if (1 == c->commandQueues.size()) {
+    cl_event finished;
+    error = clEnqueueMarkerWithWaitList(commandQueue, 0, nullptr, &finished);
+    ASYNC_CL_ERROR;
+    c->completeEvents.push_back(finished);
+    c->waitStart = NOW;
+    error = clFlush(commandQueue);
+    ASYNC_CL_ERROR;
+  }
 
   c->dataFromKernel = microTime(dataFromKernelStart);
   c->totalTime = microTime(start);
@@ -105,8 +127,16 @@ void runComplete(napi_env env, napi_status asyncStatus, void* data) {
     c->status = asyncStatus;
     c->errorMsg = "Async run of program failed to complete.";
   }
+  if (deferComplete(env, c, runComplete)) return;
   REJECT_STATUS;
 
+  // with readback the maps are enqueued behind the kernel and the wait for completion is counted as data from kernel
+  if (c->readback.empty())
+    c->kernelExec += c->waitTime;
+  else
+    c->dataFromKernel += c->waitTime;
+  c->totalTime += c->waitTime;
+
   napi_value result;
   c->status = napi_create_object(env, &result);
   REJECT_STATUS;
@@ -139,141 +169,568 @@ void runComplete(napi_env env, napi_status asyncStatus, void* data) {
   status = napi_resolve_deferred(env, c->_deferred, result);
   FLOATING_STATUS;
 
-  for (auto& paramIter: c->kernelParams)
-    delete paramIter.second;
   tidyCarrier(env, c);
 }
 
-napi_value run(napi_env env, napi_callback_info info) {
+// IEEE 754 half precision bits for a float, rounding to nearest
+uint16_t floatToHalf(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+  int32_t exp = (int32_t)((x >> 23) & 0xff) - 127 + 15;
+  uint32_t mant = x & 0x7fffff;
+  if (0xff == ((x >> 23) & 0xff))
+    return sign | 0x7c00 | (mant ? 0x200 : 0); // infinity or NaN
+  if (exp >= 31)
+    return sign | 0x7c00;
+  if (exp <= 0) {
+    if (exp < -10)
+      return sign;
+    mant |= 0x800000;
+    uint32_t shift = 14 - exp;
+    uint32_t h = mant >> shift;
+    if ((mant >> (shift - 1)) & 1) ++h;
+    return sign | (uint16_t)h;
+  }
+  uint32_t h = ((uint32_t)exp << 10) | (mant >> 13);
+  if (mant & 0x1000) ++h; // a carry rounds up into the exponent
+  return sign | (uint16_t)h;
+}
+
+int64_t toInteger(double v) {
+  if (!std::isfinite(v)) return 0;
+  if (v >= 9223372036854775808.0) return (int64_t)(uint64_t)std::min(v, 18446744073709549568.0);
+  if (v < -9223372036854775808.0) return INT64_MIN;
+  return (int64_t)v;
+}
+
+// Stores element i of a by-value argument from a JavaScript number, converting to the element type
+void setArgElement(const argTypeDesc& desc, uint8_t *bytes, uint32_t i, double v) {
+  switch (desc.elemType) {
+  case eArgElemType::CHAR: ((int8_t *)bytes)[i] = (int8_t)toInteger(v); break;
+  case eArgElemType::UCHAR: ((uint8_t *)bytes)[i] = (uint8_t)toInteger(v); break;
+  case eArgElemType::SHORT: ((int16_t *)bytes)[i] = (int16_t)toInteger(v); break;
+  case eArgElemType::USHORT: ((uint16_t *)bytes)[i] = (uint16_t)toInteger(v); break;
+  case eArgElemType::INT: ((int32_t *)bytes)[i] = (int32_t)toInteger(v); break;
+  case eArgElemType::UINT: ((uint32_t *)bytes)[i] = (uint32_t)toInteger(v); break;
+  case eArgElemType::LONG: ((int64_t *)bytes)[i] = toInteger(v); break;
+  case eArgElemType::ULONG: ((uint64_t *)bytes)[i] = (uint64_t)toInteger(v); break;
+  case eArgElemType::HALF: ((uint16_t *)bytes)[i] = floatToHalf((float)v); break;
+  case eArgElemType::FLOAT: ((float *)bytes)[i] = (float)v; break;
+  case eArgElemType::DOUBLE: ((double *)bytes)[i] = v; break;
+  default: break;
+  }
+}
+
+// Reads a vector argument value from an array or typed array with one element per vector component
+bool getVectorValue(napi_env env, napi_value paramValue, kernelParam& kp) {
+  napi_status status;
+  uint32_t numElements = kp.typeDesc.numElements;
+
+  bool isArray;
+  status = napi_is_array(env, paramValue, &isArray);
+  CHECK_BAIL;
+  bool isTypedArray;
+  status = napi_is_typedarray(env, paramValue, &isTypedArray);
+  CHECK_BAIL;
+
+  if (isArray) {
+    uint32_t length;
+    status = napi_get_array_length(env, paramValue, &length);
+    CHECK_BAIL;
+    if (length != numElements) {
+      printf("Parameter '%s' of type '%s' given an array of length %d\n", kp.name.c_str(), kp.paramType.c_str(), length);
+      status = napi_throw_range_error(env, nullptr, "Parameter array length must match the number of vector components");
+      return false;
+    }
+    for (uint32_t i = 0; i < numElements; ++i) {
+      napi_value element;
+      status = napi_get_element(env, paramValue, i, &element);
+      CHECK_BAIL;
+      double v;
+      status = napi_get_value_double(env, element, &v);
+      CHECK_BAIL;
+      setArgElement(kp.typeDesc, kp.value.bytes, i, v);
+    }
+  } else if (isTypedArray) {
+    napi_typedarray_type arrayType;
+    size_t length;
+    void *data;
+    status = napi_get_typedarray_info(env, paramValue, &arrayType, &length, &data, nullptr, nullptr);
+    CHECK_BAIL;
+    if (length != numElements) {
+      printf("Parameter '%s' of type '%s' given a typed array of length %zu\n", kp.name.c_str(), kp.paramType.c_str(), length);
+      status = napi_throw_range_error(env, nullptr, "Parameter array length must match the number of vector components");
+      return false;
+    }
+    for (uint32_t i = 0; i < numElements; ++i) {
+      double v;
+      switch (arrayType) {
+      case napi_int8_array: v = ((int8_t *)data)[i]; break;
+      case napi_uint8_array: case napi_uint8_clamped_array: v = ((uint8_t *)data)[i]; break;
+      case napi_int16_array: v = ((int16_t *)data)[i]; break;
+      case napi_uint16_array: v = ((uint16_t *)data)[i]; break;
+      case napi_int32_array: v = ((int32_t *)data)[i]; break;
+      case napi_uint32_array: v = ((uint32_t *)data)[i]; break;
+      case napi_float32_array: v = ((float *)data)[i]; break;
+      case napi_float64_array: v = ((double *)data)[i]; break;
+      default:
+        status = napi_throw_type_error(env, nullptr, "Unsupported typed array type for a vector parameter");
+        return false;
+      }
+      setArgElement(kp.typeDesc, kp.value.bytes, i, v);
+    }
+  } else {
+    printf("Parameter '%s' of type '%s' must be a number, an array or a typed array\n", kp.name.c_str(), kp.paramType.c_str());
+    status = napi_throw_type_error(env, nullptr, "Vector parameter must be a number, an array or a typed array");
+    return false;
+  }
+  return true;
+}
+
+// Reads the size in bytes of a local memory argument, either as a number or from a function called with the
+// number of work-items per group and the work-items per group in each dimension
+bool getLocalSize(napi_env env, napi_value paramValue, kernelParam& kp, const iRunParams *rp) {
+  napi_status status;
+
+  napi_valuetype valueType;
+  status = napi_typeof(env, paramValue, &valueType);
+  CHECK_BAIL;
+
+  napi_value sizeValue = paramValue;
+  if (napi_function == valueType) {
+    size_t numDims = rp->numDims();
+    const size_t *local = rp->workItemsPerGroup();
+    if (nullptr == local) {
+      printf("Local parameter '%s' needs workItemsPerGroup to be set for the program\n", kp.name.c_str());
+      status = napi_throw_error(env, nullptr, "Local memory size function requires the program workItemsPerGroup option");
+      return false;
+    }
+
+    size_t groupSize = 1;
+    napi_value dimsValue;
+    status = napi_create_array(env, &dimsValue);
+    CHECK_BAIL;
+    for (uint32_t d = 0; d < (uint32_t)numDims; ++d) {
+      groupSize *= local[d];
+      napi_value dimValue;
+      status = napi_create_int64(env, (int64_t)local[d], &dimValue);
+      CHECK_BAIL;
+      status = napi_set_element(env, dimsValue, d, dimValue);
+      CHECK_BAIL;
+    }
+    napi_value fnArgs[2];
+    status = napi_create_int64(env, (int64_t)groupSize, &fnArgs[0]);
+    CHECK_BAIL;
+    fnArgs[1] = dimsValue;
+    napi_value global;
+    status = napi_get_global(env, &global);
+    CHECK_BAIL;
+    status = napi_call_function(env, global, paramValue, 2, fnArgs, &sizeValue);
+    CHECK_BAIL;
+    status = napi_typeof(env, sizeValue, &valueType);
+    CHECK_BAIL;
+  }
+
+  if (napi_number != valueType) {
+    printf("Local parameter '%s' must be a number of bytes or a function returning one\n", kp.name.c_str());
+    status = napi_throw_type_error(env, nullptr, "Local memory parameter must be a size in bytes or a function returning one");
+    return false;
+  }
+
+  int64_t localBytes;
+  status = napi_get_value_int64(env, sizeValue, &localBytes);
+  CHECK_BAIL;
+  if ((localBytes <= 0) || ((uint64_t)localBytes > rp->deviceLocalMemSize())) {
+    printf("Local parameter '%s' size %lld is outside the device local memory size %llu\n", kp.name.c_str(),
+           (long long)localBytes, (unsigned long long)rp->deviceLocalMemSize());
+    status = napi_throw_range_error(env, nullptr, "Local memory parameter size must be greater than zero and fit the device local memory");
+    return false;
+  }
+  kp.value.localBytes = (uint64_t)localBytes;
+  return true;
+}
+
+// Checks that the local memory arguments together with the kernel's own local memory fit on the device
+bool checkLocalMemSize(napi_env env, const std::vector<kernelParam>& kernelParams, const iRunParams *rp) {
+  uint64_t totalBytes = rp->kernelLocalMemSize();
+  for (auto& kp: kernelParams)
+    if (eParamFlags::LOCAL == kp.valueType)
+      totalBytes += kp.value.localBytes;
+
+  if (totalBytes > rp->deviceLocalMemSize()) {
+    printf("Kernel local memory of %llu bytes exceeds the device local memory size %llu\n",
+           (unsigned long long)totalBytes, (unsigned long long)rp->deviceLocalMemSize());
+    napi_throw_range_error(env, nullptr, "Total kernel local memory exceeds the device local memory size");
+    return false;
+  }
+  return true;
+}
+
+// Reads the value of a kernel parameter from a number, an array of vector components, an OpenCL buffer object
+// or a local memory size, throwing an error and returning false if the value does not suit the kernel argument type
+bool getParamValue(napi_env env, napi_value paramValue, kernelParam& kp, const iRunParams *rp) {
+  napi_status status;
+  const std::string& argType(kp.paramType);
+
+  if (eParamFlags::LOCAL == kp.valueType)
+    return getLocalSize(env, paramValue, kp, rp);
+
+  napi_valuetype valueType;
+  status = napi_typeof(env, paramValue, &valueType);
+  CHECK_BAIL;
+
+  switch (valueType) {
+  case napi_undefined:
+    printf("Parameter name \'%s\' not found during run\n", kp.name.c_str());
+    status = napi_throw_error(env, nullptr, "Parameter name not found during run");
+    return false;
+  case napi_number: {
+    if (eArgElemType::NONE == kp.typeDesc.elemType) {
+      printf("Unsupported numeric parameter type: \'%s\'\n", argType.c_str());
+      status = napi_throw_type_error(env, nullptr, "Unsupported numeric parameter type");
+      return false;
+    }
+    double v;
+    status = napi_get_value_double(env, paramValue, &v);
+    CHECK_BAIL;
+    // a number given for a vector sets every component, as for scalar widening in OpenCL C
+    for (uint32_t i = 0; i < kp.typeDesc.numElements; ++i)
+      setArgElement(kp.typeDesc, kp.value.bytes, i, v);
+    break;
+  }
+  case napi_bigint: {
+    bool lossless;
+    if (eArgElemType::LONG == kp.typeDesc.elemType && 1 == kp.typeDesc.numElements)
+      status = napi_get_value_bigint_int64(env, paramValue, &kp.value.int64, &lossless);
+    else if (eArgElemType::ULONG == kp.typeDesc.elemType && 1 == kp.typeDesc.numElements)
+      status = napi_get_value_bigint_uint64(env, paramValue, (uint64_t *)&kp.value.int64, &lossless);
+    else {
+      printf("Parameter '%s' of type '%s' cannot be set from a BigInt\n", kp.name.c_str(), argType.c_str());
+      status = napi_throw_type_error(env, nullptr, "BigInt parameter values are only supported for long and ulong types");
+      return false;
+    }
+    CHECK_BAIL;
+    break;
+  }
+  case napi_object: {
+    if (eArgElemType::NONE != kp.typeDesc.elemType)
+      return getVectorValue(env, paramValue, kp);
+    kp.imageType = imageObjectType(argType);
+    if (kp.imageType) {
+      kp.valueType = eParamFlags::IMAGE;
+      kp.paramType = std::string("image");
+    } else if (std::string::npos != argType.find('*')) {
+      kp.valueType = eParamFlags::BUFFER;
+      kp.paramType = std::string("ptr");
+    } else {
+      printf("Parameter type \'%s\' not recognised as a buffer type\n", argType.c_str());
+      status = napi_throw_error(env, nullptr, "Parameter type not recognised during run");
+      return false;
+    }
+    napi_value clMemValue;
+    status = napi_get_named_property(env, paramValue, "clMemory", &clMemValue);
+    CHECK_BAIL;
+    status = napi_get_value_external(env, clMemValue, (void**)&kp.value.clMem);
+    CHECK_BAIL;
+    if ((eParamFlags::IMAGE == kp.valueType) && !kp.value.clMem->hasDimensions()) {
+      status = napi_throw_error(env, nullptr, "Buffer used as image type must provide image dimensions");
+      return false;
+    }
+    break;
+  }
+  default:
+    printf("Unsupported parameter value type: \'%d\'\n", valueType);
+    status = napi_throw_type_error(env, nullptr, "Unsupported parameter value type");
+    return false;
+  }
+  return true;
+}
+
+// Resolves the kernel, queues and parameter values for running a program, throwing an error and returning false
+// if the parameters do not match the kernel arguments
+bool getRunArgs(napi_env env, napi_value programValue, napi_value paramsValue, runArgs& ra) {
+  napi_status status;
+
+  napi_value runParamsValue;
+  status = napi_get_named_property(env, programValue, "runParams", &runParamsValue);
+  CHECK_BAIL;
+  status = napi_get_value_external(env, runParamsValue, (void**)&ra.runParams);
+  CHECK_BAIL;
+
+  napi_value runNamesValue;
+  status = napi_get_property_names(env, paramsValue, &runNamesValue);
+  CHECK_BAIL;
+
+  uint32_t runNamesCount;
+  status = napi_get_array_length(env, runNamesValue, &runNamesCount);
+  CHECK_BAIL;
+
+  const tKernelArgMap& kernelArgMap = ra.runParams->kernelArgMap();
+  uint32_t argNamesCount = (uint32_t)kernelArgMap.size();
+  if (argNamesCount != runNamesCount) {
+    status = napi_throw_error(env, nullptr, "Incorrect number of parameters");
+    return false;
+  }
+
+  for (uint32_t p=0; p<argNamesCount; ++p) {
+    iKernelArg *ka = kernelArgMap.at(p);
+    std::string argName(ka->name());
+
+    napi_value paramValue;
+    status = napi_get_named_property(env, paramsValue, argName.c_str(), &paramValue);
+    CHECK_BAIL;
+
+    ra.kernelParams.emplace_back(*ka);
+    if (!getParamValue(env, paramValue, ra.kernelParams.back(), ra.runParams))
+      return false;
+  }
+  if (!checkLocalMemSize(env, ra.kernelParams, ra.runParams))
+    return false;
+
+  // Extract externals into variables
+  napi_value jsContext;
+  void* contextData;
+  status = napi_get_named_property(env, programValue, "context", &jsContext);
+  CHECK_BAIL;
+  status = napi_get_value_external(env, jsContext, &contextData);
+  ra.context = (cl_context) contextData;
+  CHECK_BAIL;
+
+  uint32_t numQueues;
+  napi_value numQueuesVal;
+  status = napi_get_named_property(env, programValue, "numQueues", &numQueuesVal);
+  CHECK_BAIL;
+  status = napi_get_value_uint32(env, numQueuesVal, &numQueues);
+  CHECK_BAIL;
+
+  ra.commandQueues.resize(numQueues);
+  for (uint32_t i = 0; i < numQueues; ++i) {
+    std::stringstream ss;
+    ss << "commands_" << i;
+    napi_value commandQueue;
+    status = napi_get_named_property(env, programValue, ss.str().c_str(), &commandQueue);
+    CHECK_BAIL;
+    status = napi_get_value_external(env, commandQueue, (void**)&ra.commandQueues.at(i));
+    CHECK_BAIL;
+  }
+
+  napi_value jsKernel;
+  void* kernelData;
+  status = napi_get_named_property(env, programValue, "kernel", &jsKernel);
+  CHECK_BAIL;
+  status = napi_get_value_external(env, jsKernel, &kernelData);
+  ra.kernel = (cl_kernel) kernelData;
+  CHECK_BAIL;
+
+  return true;
+}
+
+// Copies the parameters of a bound object from program.bind, or resolves them from a parameters object
+bool resolveRunArgs(napi_env env, napi_value programValue, napi_value paramsValue, runArgs& ra, bool& isBound) {
+  napi_status status;
+  status = napi_has_named_property(env, paramsValue, "boundArgs", &isBound);
+  CHECK_BAIL;
+  if (isBound) {
+    napi_value boundProgramValue;
+    status = napi_get_named_property(env, paramsValue, "program", &boundProgramValue);
+    CHECK_BAIL;
+    bool sameProgram;
+    status = napi_strict_equals(env, boundProgramValue, programValue, &sameProgram);
+    CHECK_BAIL;
+    if (!sameProgram) {
+      status = napi_throw_error(env, nullptr, "Bound parameters must be run with the program that bound them.");
+      return false;
+    }
+    napi_value boundArgsValue;
+    status = napi_get_named_property(env, paramsValue, "boundArgs", &boundArgsValue);
+    CHECK_BAIL;
+    runArgs *boundArgs;
+    status = napi_get_value_external(env, boundArgsValue, (void**)&boundArgs);
+    CHECK_BAIL;
+    ra = *boundArgs;
+    return true;
+  }
+  return getRunArgs(env, programValue, paramsValue, ra);
+}
+
+void tidyBoundArgs(napi_env env, void* data, void* hint) {
+  delete (runArgs*)data;
+}
+
+// Replaces the value of one parameter of a bound parameter set
+napi_value setBound(napi_env env, napi_callback_info info) {
   napi_status status;
-  runCarrier* c = new runCarrier;
 
   napi_value args[2];
   size_t argc = 2;
-  napi_value programValue;
-  status = napi_get_cb_info(env, info, &argc, args, &programValue, nullptr);
+  napi_value boundValue;
+  status = napi_get_cb_info(env, info, &argc, args, &boundValue, nullptr);
   CHECK_STATUS;
 
-  if (!((argc > 0) && (argc <= 2))) {
-    status = napi_throw_error(env, nullptr, "Wrong number of arguments. One or two expected.");
+  if (argc != 2) {
+    status = napi_throw_error(env, nullptr, "Wrong number of arguments. Two expected.");
     return nullptr;
   }
 
   napi_valuetype t;
   status = napi_typeof(env, args[0], &t);
   CHECK_STATUS;
-  if (t != napi_object) {
-    status = napi_throw_type_error(env, nullptr, "Parameter must be an object.");
+  if (t != napi_string) {
+    status = napi_throw_type_error(env, nullptr, "Parameter name must be a string.");
     return nullptr;
   }
+  char name[256] = "";
+  status = napi_get_value_string_utf8(env, args[0], name, 256, nullptr);
+  CHECK_STATUS;
 
-  napi_value runParamsValue;
-  status = napi_get_named_property(env, programValue, "runParams", &runParamsValue);
+  napi_value boundArgsValue;
+  status = napi_get_named_property(env, boundValue, "boundArgs", &boundArgsValue);
   CHECK_STATUS;
-  status = napi_get_value_external(env, runParamsValue, (void**)&c->runParams);
+  runArgs *ra;
+  status = napi_get_value_external(env, boundArgsValue, (void**)&ra);
   CHECK_STATUS;
 
-  napi_value runNamesValue;
-  status = napi_get_property_names(env, args[0], &runNamesValue);
+  auto paramIter = std::find_if(ra->kernelParams.begin(), ra->kernelParams.end(),
+    [&name](const kernelParam& kp) { return 0 == kp.name.compare(name); });
+  if (paramIter == ra->kernelParams.end()) {
+    printf("Parameter name \'%s\' is not a parameter of the kernel\n", name);
+    status = napi_throw_error(env, nullptr, "Parameter name not found in bound parameters");
+    return nullptr;
+  }
+
+  // read into a fresh parameter so that a failed set leaves the bound value unchanged
+  iKernelArg *ka = ra->runParams->kernelArgMap().at((uint32_t)(paramIter - ra->kernelParams.begin()));
+  kernelParam kp(*ka);
+  if (!getParamValue(env, args[1], kp, ra->runParams))
+    return nullptr;
+  kernelParam prevParam = *paramIter;
+  *paramIter = kp;
+  if (!checkLocalMemSize(env, ra->kernelParams, ra->runParams)) {
+    *paramIter = prevParam;
+    return nullptr;
+  }
+
+  // hold the new value so that a buffer lives as long as the bound parameters use it
+  napi_value paramsValue;
+  status = napi_get_named_property(env, boundValue, "params", &paramsValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, paramsValue, name, args[1]);
   CHECK_STATUS;
 
-  uint32_t runNamesCount;
-  status = napi_get_array_length(env, runNamesValue, &runNamesCount);
+  return boundValue;
+}
+
+napi_value bind(napi_env env, napi_callback_info info) {
+  napi_status status;
+
+  napi_value args[1];
+  size_t argc = 1;
+  napi_value programValue;
+  status = napi_get_cb_info(env, info, &argc, args, &programValue, nullptr);
   CHECK_STATUS;
 
-  uint32_t argNamesCount = (uint32_t)c->runParams->kernelArgMap().size();
-  if (argNamesCount != runNamesCount) {
-    status = napi_throw_error(env, nullptr, "Incorrect number of parameters");
+  if (argc != 1) {
+    status = napi_throw_error(env, nullptr, "Wrong number of arguments. One expected.");
     return nullptr;
   }
 
-  for (uint32_t p=0; p<argNamesCount; ++p) {
-    iKernelArg *ka = c->runParams->kernelArgMap().at(p);
-    std::string argName(ka->name());
-    std::string argType(ka->type());
-    iKernelArg::eAccess argAccess(ka->access());
+  napi_valuetype t;
+  status = napi_typeof(env, args[0], &t);
+  CHECK_STATUS;
+  if (t != napi_object) {
+    status = napi_throw_type_error(env, nullptr, "Parameter must be an object.");
+    return nullptr;
+  }
+
+  runArgs *ra = new runArgs;
+  if (!getRunArgs(env, programValue, args[0], *ra)) {
+    delete ra;
+    return nullptr;
+  }
 
-    napi_value argNameValue;
-    status = napi_create_string_utf8(env, argName.c_str(), argName.length(), &argNameValue);
+  napi_value boundValue;
+  status = napi_create_object(env, &boundValue);
+  CHECK_STATUS;
 
+  napi_value boundArgsValue;
+  status = napi_create_external(env, ra, tidyBoundArgs, nullptr, &boundArgsValue);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, boundValue, "boundArgs", boundArgsValue);
+  CHECK_STATUS;
+
+  // the program and a copy of the parameters keep the kernel and buffers alive while bound
+  status = napi_set_named_property(env, boundValue, "program", programValue);
+  CHECK_STATUS;
+
+  napi_value paramsValue;
+  status = napi_create_object(env, &paramsValue);
+  CHECK_STATUS;
+  for (auto& kp: ra->kernelParams) {
     napi_value paramValue;
-    status = napi_get_property(env, args[0], argNameValue, &paramValue);
+    status = napi_get_named_property(env, args[0], kp.name.c_str(), &paramValue);
     CHECK_STATUS;
-    
-    napi_valuetype valueType;
-    status = napi_typeof(env, paramValue, &valueType);
+    status = napi_set_named_property(env, paramsValue, kp.name.c_str(), paramValue);
     CHECK_STATUS;
-
-    kernelParam* kp = new kernelParam(argName.c_str(), argType.c_str(), argAccess);
-    switch (valueType) {
-    case napi_undefined:
-      printf("Parameter name \'%s\' not found during run\n", argName.c_str());
-      status = napi_throw_error(env, nullptr, "Parameter name not found during run");
-      delete kp;
-      return nullptr;
-      break;
-    case napi_number:
-      if (0 == argType.compare("uint"))
-        status = napi_get_value_uint32(env, paramValue, &kp->value.uint32);
-      else if (0 == argType.compare("int"))
-        status = napi_get_value_int32(env, paramValue, &kp->value.int32);
-      else if (0 == argType.compare("long"))
-        status = napi_get_value_int64(env, paramValue, &kp->value.int64);
-      else if (0 == argType.compare("float")) {
-        double tmp = 0.0;
-        status = napi_get_value_double(env, paramValue, &tmp);
-        kp->value.flt = (float)tmp;
-      }
-      else if (0 == argType.compare("double"))
-        status = napi_get_value_double(env, paramValue, &kp->value.dbl);
-      else {
-        printf("Unsupported numeric parameter type: \'%s\'\n", argType.c_str());
-        status = napi_throw_type_error(env, nullptr, "Unsupported numeric parameter type");
-        delete kp;
-        return nullptr;
-      }
-      break;
-    case napi_object:
-      if (0 == argType.compare("image2d_t")) {
-        kp->valueType = eParamFlags::IMAGE;
-        kp->paramType = std::string("image");
-      } else if (std::string::npos != argType.find('*')) {
-        kp->valueType = eParamFlags::BUFFER;
-        kp->paramType = std::string("ptr");
-      } else {
-        printf("Parameter type \'%s\' not recognised as a buffer type\n", argType.c_str());
-        status = napi_throw_error(env, nullptr, "Parameter type not recognised during run");
-        delete kp;
-        return nullptr;
-      }
-      napi_value clMemValue;
-      status = napi_get_named_property(env, paramValue, "clMemory", &clMemValue);
-      CHECK_STATUS;
-      status = napi_get_value_external(env, clMemValue, (void**)&kp->value.clMem);
-      CHECK_STATUS;
-      if ((eParamFlags::IMAGE == kp->valueType) && !kp->value.clMem->hasDimensions()) {
-        status = napi_throw_error(env, nullptr, "Buffer used as image type must provide image dimensions");
-        delete kp;
-        return nullptr;
-      }
-      break;
-    default:
-      printf("Unsupported parameter value type: \'%d\'\n", valueType);
-      status = napi_throw_type_error(env, nullptr, "Unsupported parameter value type");
-      delete kp;
-      return nullptr;
-    }
-    
-    c->kernelParams.emplace(p, kp);
   }
+  status = napi_set_named_property(env, boundValue, "params", paramsValue);
+  CHECK_STATUS;
 
-  uint32_t numQueues;
-  napi_value numQueuesVal;
-  status = napi_get_named_property(env, programValue, "numQueues", &numQueuesVal);
+  napi_value setValue;
+  status = napi_create_function(env, "set", NAPI_AUTO_LENGTH, setBound, nullptr, &setValue);
   CHECK_STATUS;
-  status = napi_get_value_uint32(env, numQueuesVal, &numQueues);
+  status = napi_set_named_property(env, boundValue, "set", setValue);
+  CHECK_STATUS;
+
+  return boundValue;
+}
+
+napi_value run(napi_env env, napi_callback_info info) {
+  napi_status status;
+  runCarrier* c = new runCarrier;
+
+  napi_value args[3];
+  size_t argc = 3;
+  napi_value programValue;
+  status = napi_get_cb_info(env, info, &argc, args, &programValue, nullptr);
   CHECK_STATUS;
 
+  if (!((argc > 0) && (argc <= 3))) {
+    status = napi_throw_error(env, nullptr, "Wrong number of arguments. One to three expected.");
+    delete c;
+    return nullptr;
+  }
+
+  napi_valuetype t;
+  status = napi_typeof(env, args[0], &t);
+  CHECK_STATUS;
+  if (t != napi_object) {
+    status = napi_throw_type_error(env, nullptr, "Parameter must be an object.");
+    delete c;
+    return nullptr;
+  }
+
+  // parameters from program.bind are already resolved and only need copying
+  bool isBound = false;
+  if (!resolveRunArgs(env, programValue, args[0], *c, isBound)) {
+    delete c;
+    return nullptr;
+  }
+  uint32_t numQueues = (uint32_t)c->commandQueues.size();
+
+  // the options object may follow the queue number or take its place
+  napi_value optionsValue = nullptr;
+  if (argc > 2)
+    optionsValue = args[2];
+  else if (argc > 1) {
+    status = napi_typeof(env, args[1], &t);
+    CHECK_STATUS;
+    if (t == napi_object) {
+      optionsValue = args[1];
+      argc = 1;
+    }
+  }
+
   if (argc > 1) {
     status = napi_typeof(env, args[1], &t);
     CHECK_STATUS;
@@ -297,45 +754,312 @@ napi_value run(napi_env env, napi_callback_info info) {
     c->queueNum = 0;
   }
 
-  // Extract externals into variables
+  if (optionsValue) {
+    status = napi_typeof(env, optionsValue, &t);
+    CHECK_STATUS;
+    if (t != napi_object) {
+      status = napi_throw_type_error(env, nullptr, "Optional run options must be an object.");
+      return nullptr;
+    }
+
+    bool hasReadback;
+    status = napi_has_named_property(env, optionsValue, "readback", &hasReadback);
+    CHECK_STATUS;
+    if (hasReadback) {
+      napi_value readbackValue;
+      status = napi_get_named_property(env, optionsValue, "readback", &readbackValue);
+      CHECK_STATUS;
+      bool isArray;
+      status = napi_is_array(env, readbackValue, &isArray);
+      CHECK_STATUS;
+      if (!isArray) {
+        status = napi_throw_type_error(env, nullptr, "Run option readback must be an array of parameter names.");
+        return nullptr;
+      }
+
+      uint32_t readbackCount;
+      status = napi_get_array_length(env, readbackValue, &readbackCount);
+      CHECK_STATUS;
+      for (uint32_t r = 0; r < readbackCount; ++r) {
+        napi_value nameValue;
+        status = napi_get_element(env, readbackValue, r, &nameValue);
+        CHECK_STATUS;
+        char name[256] = "";
+        status = napi_get_value_string_utf8(env, nameValue, name, 256, nullptr);
+        auto paramIter = c->kernelParams.end();
+        if (napi_ok == status)
+          paramIter = std::find_if(c->kernelParams.begin(), c->kernelParams.end(),
+            [&name](const kernelParam& kp) { return 0 == kp.name.compare(name); });
+        if ((paramIter == c->kernelParams.end()) ||
+            !((eParamFlags::BUFFER == paramIter->valueType) || (eParamFlags::IMAGE == paramIter->valueType))) {
+          printf("Readback parameter \'%s\' is not a buffer parameter of the kernel\n", name);
+          status = napi_throw_error(env, nullptr, "Run option readback must name buffer parameters of the kernel.");
+          return nullptr;
+        }
+        c->readback.push_back((uint32_t)(paramIter - c->kernelParams.begin()));
+      }
+    }
+  }
+
+  // bound parameters hold their program and buffers
+  status = napi_create_reference(env, isBound ? args[0] : programValue, 1, &c->passthru);
+  CHECK_STATUS;
+
+  napi_value promise, resource_name;
+  status = napi_create_promise(env, &c->_deferred, &promise);
+  CHECK_STATUS;
+
+  status = napi_create_string_utf8(env, "Run", NAPI_AUTO_LENGTH, &resource_name);
+  CHECK_STATUS;
+  status = napi_create_async_work(env, NULL, resource_name, runExecute,
+    runComplete, c, &c->_request);
+  CHECK_STATUS;
+  status = napi_queue_async_work(env, c->_request);
+  CHECK_STATUS;
+
+  return promise;
+}
+
+struct runManyCarrier : carrier {
+  std::vector<runArgs> runs;
+  uint32_t queueNum = 0;
+  cl_command_queue commandQueue = nullptr;
+  bool waitFinish = true;
+  HR_TIME_POINT start;
+  std::vector<HR_TIME_POINT> enqueued;
+  std::vector<long long> dataToKernel;
+  std::vector<long long> kernelExec;
+};
+
+void runManyExecute(napi_env env, void* data) {
+  runManyCarrier* c = (runManyCarrier*) data;
+  cl_int error = CL_SUCCESS;
+
+  for (auto& ra: c->runs)
+    getGPUMemory(ra);
+
+  c->start = NOW;
+  for (auto& ra: c->runs) {
+    HR_TIME_POINT dataToKernelStart = NOW;
+    error = setKernelArgs(ra, c->queueNum);
+    ASYNC_CL_ERROR;
+
+    cl_event event = nullptr;
+    error = clEnqueueNDRangeKernel(c->commandQueue, ra.kernel, ra.runParams->numDims(), nullptr,
+      ra.runParams->globalWorkItems(), ra.runParams->workItemsPerGroup(), 0, nullptr, c->waitFinish ? &event : nullptr);
+    ASYNC_CL_ERROR;
+    if (event)
+      c->completeEvents.push_back(event);
+    c->dataToKernel.push_back(microTime(dataToKernelStart));
+    c->enqueued.push_back(NOW);
+  }
+
+  if (c->waitFinish) {
+    c->waitStart = NOW;
+    error = clFlush(c->commandQueue);
+    ASYNC_CL_ERROR;
+  }
+  c->totalTime = microTime(c->start);
+}
+
+void runManyComplete(napi_env env, napi_status asyncStatus, void* data) {
+  runManyCarrier* c = (runManyCarrier*) data;
+
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async run of many programs failed to complete.";
+  }
+  if (deferComplete(env, c, runManyComplete)) return;
+  REJECT_STATUS;
+
+  // kernels follow each other on the in-order queue, so each one is timed from the later of its enqueue
+  // and the completion of the kernel before it
+  HR_TIME_POINT prevComplete = c->start;
+  for (size_t i = 0; i < c->runs.size(); ++i) {
+    if (c->eventsComplete) {
+      HR_TIME_POINT complete = c->completeTimes[i];
+      HR_TIME_POINT execStart = std::max(prevComplete, c->enqueued[i]);
+      long long exec = std::chrono::duration_cast<std::chrono::microseconds>(complete - execStart).count();
+      c->kernelExec.push_back(std::max(exec, 0LL)); // callbacks may report completions slightly out of order
+      prevComplete = std::max(prevComplete, complete);
+    } else
+      c->kernelExec.push_back(0);
+  }
+
+  napi_value result;
+  c->status = napi_create_array_with_length(env, c->runs.size(), &result);
+  REJECT_STATUS;
+
+  for (uint32_t i = 0; i < (uint32_t)c->runs.size(); ++i) {
+    napi_value timings;
+    c->status = napi_create_object(env, &timings);
+    REJECT_STATUS;
+
+    napi_value totalValue;
+    c->status = napi_create_int64(env, (int64_t) (c->dataToKernel[i] + c->kernelExec[i]), &totalValue);
+    REJECT_STATUS;
+    c->status = napi_set_named_property(env, timings, "totalTime", totalValue);
+    REJECT_STATUS;
+
+    napi_value dataToValue;
+    c->status = napi_create_int64(env, (int64_t) c->dataToKernel[i], &dataToValue);
+    REJECT_STATUS;
+    c->status = napi_set_named_property(env, timings, "dataToKernel", dataToValue);
+    REJECT_STATUS;
+
+    napi_value kernelExecValue;
+    c->status = napi_create_int64(env, (int64_t) c->kernelExec[i], &kernelExecValue);
+    REJECT_STATUS;
+    c->status = napi_set_named_property(env, timings, "kernelExec", kernelExecValue);
+    REJECT_STATUS;
+
+    napi_value dataFromValue;
+    c->status = napi_create_int64(env, 0, &dataFromValue);
+    REJECT_STATUS;
+    c->status = napi_set_named_property(env, timings, "dataFromKernel", dataFromValue);
+    REJECT_STATUS;
+
+    c->status = napi_set_element(env, result, i, timings);
+    REJECT_STATUS;
+  }
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+napi_value runMany(napi_env env, napi_callback_info info) {
+  napi_status status;
+  runManyCarrier* c = new runManyCarrier;
+
+  napi_value args[2];
+  size_t argc = 2;
+  napi_value contextValue;
+  status = napi_get_cb_info(env, info, &argc, args, &contextValue, nullptr);
+  CHECK_STATUS;
+
+  bool isArray = false;
+  if (argc > 0) {
+    status = napi_is_array(env, args[0], &isArray);
+    CHECK_STATUS;
+  }
+  if (!isArray) {
+    status = napi_throw_type_error(env, nullptr, "First argument must be an array of program runs.");
+    delete c;
+    return nullptr;
+  }
+
   napi_value jsContext;
   void* contextData;
-  status = napi_get_named_property(env, programValue, "context", &jsContext);
+  status = napi_get_named_property(env, contextValue, "context", &jsContext);
   CHECK_STATUS;
   status = napi_get_value_external(env, jsContext, &contextData);
-  c->context = (cl_context) contextData;
   CHECK_STATUS;
 
-  c->commandQueues.resize(numQueues);
-  for (uint32_t i = 0; i < numQueues; ++i) {
-    std::stringstream ss;
-    ss << "commands_" << i;
-    napi_value commandQueue;
-    status = napi_get_named_property(env, programValue, ss.str().c_str(), &commandQueue);
+  uint32_t numQueues;
+  napi_value numQueuesVal;
+  status = napi_get_named_property(env, contextValue, "numQueues", &numQueuesVal);
+  CHECK_STATUS;
+  status = napi_get_value_uint32(env, numQueuesVal, &numQueues);
+  CHECK_STATUS;
+
+  int32_t queueNum = 0;
+  if (argc > 1) {
+    status = napi_get_value_int32(env, args[1], &queueNum);
+    if ((napi_ok != status) || !((queueNum >= 0) && (queueNum < (int32_t)numQueues))) {
+      status = napi_throw_range_error(env, nullptr, "Optional parameter queueNum out of range.");
+      delete c;
+      return nullptr;
+    }
+  }
+  c->queueNum = (uint32_t)queueNum;
+  c->waitFinish = (1 == numQueues);
+
+  uint32_t numRuns;
+  status = napi_get_array_length(env, args[0], &numRuns);
+  CHECK_STATUS;
+
+  // there is nothing to enqueue or wait for, so resolve straight away
+  if (0 == numRuns) {
+    delete c;
+    napi_deferred deferred;
+    napi_value promise, result;
+    status = napi_create_promise(env, &deferred, &promise);
+    CHECK_STATUS;
+    status = napi_create_array(env, &result);
     CHECK_STATUS;
-    c->status = napi_get_value_external(env, commandQueue, (void**)&c->commandQueues.at(i));
+    status = napi_resolve_deferred(env, deferred, result);
     CHECK_STATUS;
+    return promise;
   }
 
-  napi_value jsKernel;
-  void* kernelData;
-  status = napi_get_named_property(env, programValue, "kernel", &jsKernel);
-  CHECK_STATUS;
-  status = napi_get_value_external(env, jsKernel, &kernelData);
-  c->kernel = (cl_kernel) kernelData;
+  // hold the programs and parameters until the work is complete
+  napi_value holdValue;
+  status = napi_create_array_with_length(env, numRuns * 2, &holdValue);
   CHECK_STATUS;
 
-  status = napi_create_reference(env, programValue, 1, &c->passthru);
+  c->runs.resize(numRuns);
+  for (uint32_t i = 0; i < numRuns; ++i) {
+    napi_value itemValue;
+    status = napi_get_element(env, args[0], i, &itemValue);
+    CHECK_STATUS;
+    napi_valuetype t;
+    status = napi_typeof(env, itemValue, &t);
+    CHECK_STATUS;
+    napi_value programValue = nullptr;
+    napi_value paramsValue = nullptr;
+    bool hasRunParams = false;
+    if (t == napi_object) {
+      status = napi_get_named_property(env, itemValue, "program", &programValue);
+      CHECK_STATUS;
+      status = napi_get_named_property(env, itemValue, "params", &paramsValue);
+      CHECK_STATUS;
+      status = napi_typeof(env, programValue, &t);
+      CHECK_STATUS;
+      if (t == napi_object) {
+        status = napi_has_named_property(env, programValue, "runParams", &hasRunParams);
+        CHECK_STATUS;
+      }
+      status = napi_typeof(env, paramsValue, &t);
+      CHECK_STATUS;
+    }
+    if (!hasRunParams || (t != napi_object)) {
+      status = napi_throw_type_error(env, nullptr, "Each run must have an OpenCL program and a parameters object.");
+      delete c;
+      return nullptr;
+    }
+
+    bool isBound = false;
+    if (!resolveRunArgs(env, programValue, paramsValue, c->runs[i], isBound)) {
+      delete c;
+      return nullptr;
+    }
+    if (c->runs[i].context != (cl_context)contextData) {
+      status = napi_throw_error(env, nullptr, "Each program must have been created by this context.");
+      delete c;
+      return nullptr;
+    }
+
+    status = napi_set_element(env, holdValue, i * 2, programValue);
+    CHECK_STATUS;
+    status = napi_set_element(env, holdValue, i * 2 + 1, paramsValue);
+    CHECK_STATUS;
+  }
+  c->commandQueue = c->runs[0].commandQueues.at(c->queueNum);
+
+  status = napi_create_reference(env, holdValue, 1, &c->passthru);
   CHECK_STATUS;
 
   napi_value promise, resource_name;
   status = napi_create_promise(env, &c->_deferred, &promise);
   CHECK_STATUS;
 
-  status = napi_create_string_utf8(env, "Run", NAPI_AUTO_LENGTH, &resource_name);
+  status = napi_create_string_utf8(env, "RunMany", NAPI_AUTO_LENGTH, &resource_name);
   CHECK_STATUS;
-  status = napi_create_async_work(env, NULL, resource_name, runExecute,
-    runComplete, c, &c->_request);
+  status = napi_create_async_work(env, NULL, resource_name, runManyExecute,
+    runManyComplete, c, &c->_request);
   CHECK_STATUS;
   status = napi_queue_async_work(env, c->_request);
   CHECK_STATUS;
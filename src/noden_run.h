@@ -32,39 +32,51 @@
 class iClMemory;
 class iGpuMemory;
 
-enum class eParamFlags : uint8_t { VALUE = 0, BUFFER = 1, IMAGE = 2 };
+enum class eParamFlags : uint8_t { VALUE = 0, BUFFER = 1, IMAGE = 2, LOCAL = 3 };
 
 struct kernelParam {
-  kernelParam(const std::string& paramName, const std::string& paramType, iKernelArg::eAccess access) : 
-    name(paramName), paramType(paramType), access(access), valueType(eParamFlags::VALUE), value(0) {}
-  const std::string name;
+  kernelParam(const iKernelArg& ka) :
+    name(ka.name()), paramType(ka.type()), typeDesc(ka.typeDesc()), access(ka.access()),
+    valueType(iKernelArg::eAddress::LOCAL == ka.address() ? eParamFlags::LOCAL : eParamFlags::VALUE),
+    imageType(0), value(0) {}
+  std::string name;
   std::string paramType;
+  argTypeDesc typeDesc;
   iKernelArg::eAccess access;
   eParamFlags valueType;
+  cl_mem_object_type imageType;
   union paramVal {
     paramVal(int64_t i): int64(i) {}
-    uint32_t uint32;
-    int32_t int32;
     int64_t int64;
-    float flt;
-    double dbl;
+    uint64_t localBytes; // size of a local memory argument
+    uint8_t bytes[128]; // scalar or vector value laid out as the kernel expects, up to a double16
     iClMemory* clMem;
   } value;
   std::shared_ptr<iGpuMemory> gpuAccess;
 };
 
-struct runCarrier : carrier {
-  std::map<uint32_t, kernelParam*> kernelParams;
-  iRunParams *runParams;
+// Everything a run needs from a program and its parameters, resolved from JavaScript values.
+// program.bind holds one of these so that each run of the bound parameters only has to copy it.
+struct runArgs {
+  iRunParams *runParams = nullptr;
+  cl_context context = nullptr;
+  std::vector<cl_command_queue> commandQueues;
+  cl_kernel kernel = nullptr;
+  std::vector<kernelParam> kernelParams; // indexed by kernel argument number
+};
+
+struct runCarrier : carrier, runArgs {
   uint32_t queueNum = 0;
+  // buffer parameters to be made readable by the host once the kernel is complete
+  std::vector<uint32_t> readback;
   long long dataToKernel;
   long long kernelExec;
   long long dataFromKernel;
-  cl_context context;
-  std::vector<cl_command_queue> commandQueues;
-  cl_kernel kernel;
 };
 
 napi_value run(napi_env env, napi_callback_info info);
+napi_value bind(napi_env env, napi_callback_info info);
+// Enqueues the kernels of many programs back to back on one queue in a single asynchronous work item
+napi_value runMany(napi_env env, napi_callback_info info);
 
 #endif
@@ -22,6 +22,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
 #include "noden_util.h"
 #include "node_api.h"
 
@@ -226,3 +228,162 @@ int32_t rejectStatus(napi_env env, carrier* c, const char* file, int32_t line) {
   }
   return c->status;
 }
+
+// Completion state for each environment, so that worker threads do not share threadsafe functions
+struct eventCompletion {
+  napi_threadsafe_function tsfn = nullptr;
+  // deletes references that background threads have finished with
+  napi_threadsafe_function refTsfn = nullptr;
+  // waits with callbacks still to come, which keep the event loop alive
+  uint32_t pendingWaits = 0;
+};
+
+struct eventWait {
+  eventCompletion* ec;
+  carrier* c;
+  napi_async_complete_callback complete;
+  std::atomic<uint32_t> remaining;
+  std::atomic<int32_t> eventStatus;
+};
+
+void callComplete(napi_env env, napi_value jsCallback, void* context, void* data) {
+  eventWait* w = (eventWait*)data;
+  eventCompletion* ec = (eventCompletion*)context;
+  ec->pendingWaits--;
+  if (nullptr == env) { // the environment is shutting down, so there is no promise left to settle
+    delete w->c;
+    delete w;
+    return;
+  }
+  if (0 == ec->pendingWaits)
+    napi_unref_threadsafe_function(env, ec->tsfn);
+
+  carrier* c = w->c;
+  cl_int eventStatus = w->eventStatus;
+  napi_async_complete_callback complete = w->complete;
+  delete w;
+
+  c->eventsComplete = true;
+  c->waitTime = std::chrono::duration_cast<std::chrono::microseconds>(
+    *std::max_element(c->completeTimes.begin(), c->completeTimes.end()) - c->waitStart).count();
+  if ((eventStatus < 0) && (NODEN_SUCCESS == c->status)) {
+    c->status = eventStatus;
+    char errorMsg[200];
+    sprintf(errorMsg, "Enqueued OpenCL work failed with error %i of type %s.", eventStatus, clGetErrorString(eventStatus));
+    c->errorMsg = std::string(errorMsg);
+  }
+  complete(env, napi_ok, c);
+}
+
+void CL_CALLBACK eventComplete(cl_event event, cl_int eventStatus, void* userData) {
+  eventWait* w = (eventWait*)userData;
+  std::vector<cl_event>& events = w->c->completeEvents;
+  size_t i = std::find(events.begin(), events.end(), event) - events.begin();
+  if (i < events.size())
+    w->c->completeTimes[i] = NOW;
+  if (eventStatus < 0)
+    w->eventStatus = eventStatus;
+  if (1 == w->remaining--)
+    napi_call_threadsafe_function(w->ec->tsfn, w, napi_tsfn_nonblocking);
+}
+
+struct refRelease {
+  napi_threadsafe_function tsfn;
+  napi_ref ref;
+};
+
+void callDeleteRef(napi_env env, napi_value jsCallback, void* context, void* data) {
+  refRelease* r = (refRelease*)data;
+  if (env) {
+    napi_status status = napi_delete_reference(env, r->ref);
+    checkStatus(env, status, __FILE__, __LINE__ - 1);
+  }
+  delete r;
+}
+
+void* prepareRefRelease(napi_env env, napi_ref ref) {
+  eventCompletion* ec = nullptr;
+  if ((napi_ok != napi_get_instance_data(env, (void**)&ec)) || (nullptr == ec) || (nullptr == ec->refTsfn))
+    return nullptr;
+  return new refRelease { ec->refTsfn, ref };
+}
+
+void releaseRef(void* data) {
+  refRelease* r = (refRelease*)data;
+  if (napi_ok != napi_call_threadsafe_function(r->tsfn, r, napi_tsfn_nonblocking))
+    delete r; // the environment is shutting down
+}
+
+// The environment's cleanup hooks close the threadsafe function before the instance data is finalized
+void finalizeEventCompletion(napi_env env, void* data, void* hint) {
+  delete (eventCompletion*)data;
+}
+
+napi_status initEventCompletion(napi_env env) {
+  napi_status status;
+  eventCompletion* ec = new eventCompletion;
+  status = napi_set_instance_data(env, ec, finalizeEventCompletion, nullptr);
+  if (napi_ok != status) {
+    delete ec;
+    return status;
+  }
+  napi_value name;
+  status = napi_create_string_utf8(env, "EventCompletion", NAPI_AUTO_LENGTH, &name);
+  PASS_STATUS;
+  status = napi_create_threadsafe_function(env, nullptr, nullptr, name, 0, 1, nullptr, nullptr, ec,
+    callComplete, &ec->tsfn);
+  PASS_STATUS;
+  status = napi_unref_threadsafe_function(env, ec->tsfn);
+  PASS_STATUS;
+
+  status = napi_create_string_utf8(env, "ReferenceRelease", NAPI_AUTO_LENGTH, &name);
+  PASS_STATUS;
+  status = napi_create_threadsafe_function(env, nullptr, nullptr, name, 0, 1, nullptr, nullptr, nullptr,
+    callDeleteRef, &ec->refTsfn);
+  PASS_STATUS;
+  return napi_unref_threadsafe_function(env, ec->refTsfn);
+}
+
+bool deferComplete(napi_env env, carrier* c, napi_async_complete_callback complete) {
+  if (c->completeEvents.empty() || c->eventsComplete || (NODEN_SUCCESS != c->status))
+    return false;
+  eventCompletion* ec = nullptr;
+  if ((napi_ok != napi_get_instance_data(env, (void**)&ec)) || (nullptr == ec) || (nullptr == ec->tsfn))
+    return false;
+
+  uint32_t numEvents = (uint32_t)c->completeEvents.size();
+  c->completeTimes.assign(numEvents, NOW);
+  eventWait* w = new eventWait;
+  w->ec = ec;
+  w->c = c;
+  w->complete = complete;
+  w->remaining = numEvents;
+  w->eventStatus = CL_SUCCESS;
+
+  if (0 == ec->pendingWaits++)
+    napi_ref_threadsafe_function(env, ec->tsfn);
+  for (uint32_t i = 0; i < numEvents; ++i) {
+    cl_int error = clSetEventCallback(c->completeEvents[i], CL_COMPLETE, eventComplete, w);
+    if (CL_SUCCESS != error) {
+      // the callbacks already set still count down, so only the events without one are taken off
+      w->eventStatus = error;
+      if ((numEvents - i) == w->remaining.fetch_sub(numEvents - i))
+        napi_call_threadsafe_function(ec->tsfn, w, napi_tsfn_nonblocking);
+      break;
+    }
+  }
+  return true;
+}
+
+napi_status queueNextStage(napi_env env, carrier* c, const char* name,
+  napi_async_execute_callback execute, napi_async_complete_callback complete) {
+  napi_status status;
+  status = napi_delete_async_work(env, c->_request);
+  PASS_STATUS;
+  napi_value resource_name;
+  status = napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resource_name);
+  PASS_STATUS;
+  status = napi_create_async_work(env, NULL, resource_name, execute, complete, c, &c->_request);
+  PASS_STATUS;
+  return napi_queue_async_work(env, c->_request);
+}
@@ -24,6 +24,7 @@
 #include <chrono>
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include "node_api.h"
 
 #define DECLARE_NAPI_METHOD(name, func) { name, 0, func, 0, 0, 0, napi_default, 0 }
@@ -31,6 +32,7 @@
 // Handling NAPI errors - use "napi_status status;" where used
 #define CHECK_STATUS if (checkStatus(env, status, __FILE__, __LINE__ - 1) != napi_ok) return nullptr
 #define PASS_STATUS if (status != napi_ok) return status
+#define CHECK_BAIL if (checkStatus(env, status, __FILE__, __LINE__ - 1) != napi_ok) return false
 
 napi_status checkStatus(napi_env env, napi_status status,
   const char * file, uint32_t line);
@@ -66,18 +68,44 @@ napi_status checkArgs(napi_env env, napi_callback_info info, const char* methodN
 #define NODEN_SUCCESS 0
 
 struct carrier {
-  virtual ~carrier() {}
+  virtual ~carrier() {
+    for (auto event: completeEvents)
+      clReleaseEvent(event);
+  }
   napi_ref passthru = nullptr;
   int32_t status = NODEN_SUCCESS;
   std::string errorMsg;
   long long totalTime;
   napi_deferred _deferred;
   napi_async_work _request;
+  // events that the async work enqueued and that must complete before the promise settles, with the time
+  // each one completed. The carrier releases them.
+  std::vector<cl_event> completeEvents;
+  std::vector<HR_TIME_POINT> completeTimes;
+  bool eventsComplete = false;
+  // set when the events are enqueued, giving the wait time from then until the last of them completed
+  HR_TIME_POINT waitStart;
+  long long waitTime = 0;
 };
 
 void tidyCarrier(napi_env env, carrier* c);
 int32_t rejectStatus(napi_env env, carrier* c, const char* file, int32_t line);
 
+// Creates the thread-safe functions that event callbacks and background threads use to reach the JavaScript thread, held in the instance
+// data of the environment so that each worker thread has its own. Call from module init.
+napi_status initEventCompletion(napi_env env);
+// For use at the start of an async complete callback. When the work left completeEvents to wait for, returns true
+// and calls complete again on the JavaScript thread once every event has completed, so that no libuv worker thread
+// is held blocked waiting for the device.
+bool deferComplete(napi_env env, carrier* c, napi_async_complete_callback complete);
+// Gives the data for releaseRef to delete ref later from any thread, or nullptr on failure
+void* prepareRefRelease(napi_env env, napi_ref ref);
+// Deletes the reference given to prepareRefRelease on the JavaScript thread and frees data. Safe to call from any thread.
+void releaseRef(void* data);
+// Replaces the carrier's completed async work with a further stage, for host work that follows the device work
+napi_status queueNextStage(napi_env env, carrier* c, const char* name,
+  napi_async_execute_callback execute, napi_async_complete_callback complete);
+
 #define ASYNC_CL_ERROR if (error != CL_SUCCESS) { \
   c->status = error; \
   char errorMsg[200]; \
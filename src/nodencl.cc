@@ -29,6 +29,9 @@ napi_value Init(napi_env env, napi_value exports) {
   status = napi_define_properties(env, exports, 3, desc);
   CHECK_STATUS;
 
+  status = initEventCompletion(env);
+  CHECK_STATUS;
+
   return exports;
 }
 
@@ -18,15 +18,32 @@
 
 #include <string>
 #include <map>
+#include <stdint.h>
+
+// Element type of a kernel argument passed by value, NONE for pointers, images and unsupported types
+enum class eArgElemType : uint8_t { NONE = 0, CHAR, UCHAR, SHORT, USHORT, INT, UINT, LONG, ULONG, HALF, FLOAT, DOUBLE };
+
+// Layout of a scalar or vector kernel argument, classified once from its type name when the program is built
+struct argTypeDesc {
+  eArgElemType elemType = eArgElemType::NONE;
+  uint8_t numElements = 0; // 1 for scalars, 2, 3, 4, 8 or 16 for vectors
+  uint16_t numBytes = 0; // size of the argument value, a 3-component vector being the size of a 4-component one
+};
+
+// Classifies a type name reported by CL_KERNEL_ARG_TYPE_NAME. size_t and related types take the device address size.
+argTypeDesc classifyArgType(const std::string& typeName, uint32_t addressBits);
 
 class iKernelArg {
 public:
   enum class eAccess : uint8_t { NONE = 0, READONLY = 1, WRITEONLY = 2 };
+  enum class eAddress : uint8_t { PRIVATE = 0, GLOBAL = 1, CONSTANT = 2, LOCAL = 3 };
   virtual ~iKernelArg() {}
 
   virtual std::string name() const = 0;
   virtual std::string type() const = 0;
   virtual eAccess access() const = 0;
+  virtual eAddress address() const = 0;
+  virtual const argTypeDesc& typeDesc() const = 0;
 
   virtual std::string toString() const = 0;
 };
@@ -39,7 +56,10 @@ public:
   virtual size_t numDims() const = 0;
   virtual const size_t *globalWorkItems() const = 0;
   virtual const size_t *workItemsPerGroup() const = 0;
-  virtual const tKernelArgMap kernelArgMap() const = 0;
+  virtual const tKernelArgMap& kernelArgMap() const = 0;
+  // local memory used by the kernel itself and the local memory available to a work-group on the device
+  virtual uint64_t kernelLocalMemSize() const = 0;
+  virtual uint64_t deviceLocalMemSize() const = 0;
 };
 
 #endif
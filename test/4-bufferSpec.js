@@ -43,6 +43,7 @@ platformInfo.forEach((platform, pi) => {
   svmTypes[pi].push([]);
   platform.devices.forEach((device, di) => {
     svmTypes[pi][di].push('none');
+    svmTypes[pi][di].push('staged');
     if (device.svmCapabilities.includes('CL_DEVICE_SVM_COARSE_GRAIN_BUFFER'))
       svmTypes[pi][di].push('coarse');
     if (device.svmCapabilities.includes('CL_DEVICE_SVM_FINE_GRAIN_BUFFER'))
@@ -121,3 +122,290 @@ createContext('Create buffer and request host access with incorrect access param
     t.pass(`incorrect host access parameter produces ${err}`);
   }
 });
+
+createContext('Create buffer and request host access to a region', async (t, clContext) => {
+  const testBuffer = await clContext.createBuffer(numBytes, 'readwrite', 'none');
+  await testBuffer.hostAccess('writeonly');
+  testBuffer.fill(0x5a);
+  const region = await testBuffer.hostAccess('readwrite', { offset: 1024, length: 256 });
+  t.ok(Buffer.isBuffer(region), 'region access resolves to a Buffer');
+  t.equal(region.length, 256, 'region view has the requested length');
+  t.equal(region[0], 0x5a, 'region view has the buffer contents');
+  region.fill(0xa5);
+  await testBuffer.hostAccess('readonly');
+  t.equal(testBuffer[1023], 0x5a, 'data before the region is unchanged');
+  t.equal(testBuffer[1024], 0xa5, 'data written to the region view is in the buffer');
+  t.equal(testBuffer[1024 + 256], 0x5a, 'data after the region is unchanged');
+
+  try {
+    await testBuffer.hostAccess('readonly', { offset: numBytes - 16, length: 32 });
+    t.fail('region beyond the end of the buffer should give error');
+  } catch (err) {
+    t.pass(`region beyond the end of the buffer produces ${err}`);
+  }
+});
+
+createContext('Create buffer, release and create again from the pool', async (t, clContext) => {
+  const firstBuffer = await clContext.createBuffer(numBytes, 'readwrite', 'none', {}, 'poolTest');
+  firstBuffer.release();
+  const beforeStats = clContext.getMemStats();
+  t.ok(beforeStats.poolRetainedBytes + beforeStats.pendingReleaseBytes >= numBytes, 'released allocation is retained by the pool');
+  const secondBuffer = await clContext.createBuffer(numBytes, 'readwrite', 'none', {}, 'poolTest');
+  const afterStats = clContext.getMemStats();
+  t.equal(afterStats.poolHits, beforeStats.poolHits + 1, 'allocation was reused from the pool');
+  t.equal(secondBuffer.numBytes, numBytes, 'reused buffer has correct size');
+  secondBuffer.release();
+});
+
+createContext('Use of a released buffer gives error', async (t, clContext) => {
+  const testBuffer = await clContext.createBuffer(numBytes, 'readwrite', 'none', {}, 'releasedTest');
+  testBuffer.release();
+  t.notOk(testBuffer.reserved, 'released buffer is not reserved');
+  try {
+    await testBuffer.hostAccess('readonly');
+    t.fail('host access to a released buffer should give error');
+  } catch (err) {
+    t.pass(`host access to a released buffer produces ${err}`);
+  }
+  try {
+    await testBuffer.fill(0, {});
+    t.fail('fill of a released buffer should give error');
+  } catch (err) {
+    t.pass(`fill of a released buffer produces ${err}`);
+  }
+});
+
+const busyKernel = `
+  __kernel void busy(__global uint* restrict buf, uint iterations) {
+    uint id = get_global_id(0);
+    uint v = buf[id];
+    for (uint i=0; i<iterations; ++i)
+      v = v * 1664525 + 1013904223;
+    buf[id] = v;
+  }
+`;
+
+createContext('Release buffers without blocking the event loop', async (t, clContext) => {
+  const busyProgram = await clContext.createProgram(busyKernel, { name: 'busy', globalWorkItems: 256 });
+  const buffers = [];
+  for (let i=0; i<8; ++i)
+    buffers.push(await clContext.createBuffer(numBytes * 4, 'readwrite', 'none', {}, 'releaseTest'));
+  // keep the device busy, so that releases have to wait for the work queued ahead of them
+  const busyBuffer = await clContext.createBuffer(1024, 'readwrite', 'none', {}, 'busyTest');
+  const running = busyProgram.run({ buf: busyBuffer, iterations: 1 << 24 });
+  await new Promise(resolve => setTimeout(resolve, 20));
+  buffers.forEach(b => b.release());
+  const stats = clContext.getMemStats();
+  t.ok(stats.pendingReleases > 0, `${stats.pendingReleases} releases are pending on the reclaimer thread while the device is busy`);
+  await running;
+  busyBuffer.release();
+  const reused = await clContext.createBuffer(numBytes * 4, 'readwrite', 'none', {}, 'releaseTest');
+  t.ok(clContext.getMemStats().poolHits > stats.poolHits, 'a pending release was waited for and reused');
+  reused.release();
+});
+
+createContext('Create small buffers from a slab', async (t, clContext) => {
+  const colMatrix = Float32Array.from([ 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0 ]);
+  const matBuffers = await Promise.all([...new Array(4)].map(() =>
+    clContext.createBuffer(colMatrix.byteLength, 'readonly', 'none', {}, 'slabTest')));
+  const stats = clContext.getMemStats();
+  t.equal(stats.slabBlocksInUse, 4, 'small buffers allocated from a slab');
+  t.ok(stats.slabBytes > 0, 'slab parent allocation created');
+  await matBuffers[0].hostAccess('writeonly', Buffer.from(colMatrix.buffer));
+  t.deepEqual(matBuffers[0].slice(0, colMatrix.byteLength), Buffer.from(colMatrix.buffer), 'slab buffer contains expected data');
+  matBuffers.forEach(b => b.release());
+  const releaseStats = clContext.getMemStats();
+  t.ok(releaseStats.slabBlocksInUse <= releaseStats.pendingReleases, 'slab blocks in use are only those still pending release');
+  await clContext.waitFinish();
+  while (clContext.getMemStats().pendingReleases > 0)
+    await new Promise(resolve => setTimeout(resolve, 1));
+  t.equal(clContext.getMemStats().slabBlocksInUse, 0, 'slab blocks returned once releases are complete');
+});
+
+tape('Create large buffer and request host access with parallel source copy', async t => {
+  const clContext = new addon.clContext(Object.assign({ copyThreads: 4, copyMinBytes: 65536, copyChunkBytes: 65536 }, properties));
+  try {
+    await clContext.initialise();
+    const frameBytes = 3840 * 2160 * 2 * 5 / 4 + 17; // 4K 4:2:2 10-bit, not a multiple of the chunk size
+    const srcBuf = Buffer.alloc(frameBytes);
+    for (let i=0; i<frameBytes; ++i)
+      srcBuf[i] = (i * 131 + 7) & 0xff;
+    const testBuffer = await clContext.createBuffer(frameBytes, 'readonly', 'none');
+    const timings = await testBuffer.hostAccess('writeonly', srcBuf);
+    t.equal(timings.copyBytes, frameBytes, 'host access reports bytes copied');
+    t.ok(timings.copyGBps > 0, `host access reports copy rate ${timings.copyGBps.toFixed(2)}GB/s`);
+    t.ok(testBuffer.equals(srcBuf), 'buffer contains expected data');
+    await clContext.close(t.end);
+  } catch (err) {
+    t.fail(err);
+    t.end();
+  }
+});
+
+createContext('Copy between buffers on the device', async (t, clContext) => {
+  const srcData = Buffer.alloc(numBytes);
+  for (let i=0; i<numBytes; ++i)
+    srcData[i] = i & 0xff;
+  const srcBuffer = await clContext.createBuffer(numBytes, 'readwrite', 'none');
+  await srcBuffer.hostAccess('writeonly', srcData);
+  const dstBuffer = await clContext.createBuffer(numBytes, 'readwrite', 'none');
+  await dstBuffer.hostAccess('writeonly', Buffer.alloc(numBytes));
+
+  const timings = await clContext.copyBuffer(srcBuffer, dstBuffer, { srcOffset: 256, dstOffset: 1024, bytes: 4096 });
+  t.equal(timings.copyBytes, 4096, 'copy reports bytes copied');
+  await dstBuffer.hostAccess('readonly');
+  t.ok(dstBuffer.slice(1024, 1024 + 4096).equals(srcData.slice(256, 256 + 4096)), 'destination contains copied data');
+  t.equal(dstBuffer[1023], 0, 'data before the destination offset is unchanged');
+
+  // extract a 16 byte x 4 row tile from the source, treated as 256 byte rows
+  const tileBuffer = await clContext.createBuffer(64, 'readwrite', 'none');
+  await clContext.copyBufferRect(srcBuffer, tileBuffer, { srcOrigin: [ 32, 2, 0 ], region: [ 16, 4, 1 ], srcRowPitch: 256 });
+  await tileBuffer.hostAccess('readonly');
+  for (let r=0; r<4; ++r)
+    t.ok(tileBuffer.slice(r * 16, r * 16 + 16).equals(srcData.slice((r + 2) * 256 + 32, (r + 2) * 256 + 48)), `tile row ${r} is correct`);
+
+  try {
+    await clContext.copyBuffer(srcBuffer, tileBuffer, { bytes: numBytes });
+    t.fail('copy larger than the destination should give error');
+  } catch (err) {
+    t.pass(`copy larger than the destination produces ${err}`);
+  }
+});
+
+createContext('Fill buffer on the device', async (t, clContext) => {
+  const testBuffer = await clContext.createBuffer(numBytes, 'readwrite', 'none');
+  testBuffer.fill(0xe5);
+  t.equal(testBuffer[numBytes - 1], 0xe5, 'fill without options is a host fill');
+
+  await testBuffer.fill(Buffer.from([ 1, 2, 3, 4 ]), { offset: 1024, size: 4096 });
+  await testBuffer.hostAccess('readonly');
+  t.equal(testBuffer[1023], 0xe5, 'data before the fill offset is unchanged');
+  t.deepEqual([...testBuffer.slice(1024, 1032)], [ 1, 2, 3, 4, 1, 2, 3, 4 ], 'pattern filled on the device');
+  t.equal(testBuffer[1024 + 4096], 0xe5, 'data after the fill size is unchanged');
+
+  /* global BigInt64Array */
+  const bigPattern = new BigInt64Array(new Uint8Array([ 1, 2, 3, 4, 5, 6, 7, 8 ]).buffer);
+  await testBuffer.fill(bigPattern, { offset: 8192, size: 4096 });
+  await testBuffer.hostAccess('readonly');
+  t.deepEqual([...testBuffer.slice(8192, 8208)], [ 1, 2, 3, 4, 5, 6, 7, 8, 1, 2, 3, 4, 5, 6, 7, 8 ],
+    'BigInt64Array pattern filled with all of its bytes');
+
+  try {
+    await testBuffer.fill(Buffer.from([ 1, 2, 3 ]), {});
+    t.fail('pattern size that is not a power of two should give error');
+  } catch (err) {
+    t.pass(`pattern size that is not a power of two produces ${err}`);
+  }
+});
+
+createContext('Host access to many buffers at once', async (t, clContext) => {
+  const bufA = await clContext.createBuffer(numBytes, 'readwrite', 'none');
+  const bufB = await clContext.createBuffer(numBytes, 'readwrite', 'none');
+  const srcA = Buffer.alloc(numBytes, 0x1a);
+  const srcB = Buffer.alloc(numBytes / 2, 0x1b);
+  const timings = await clContext.hostAccessMany([
+    { buf: bufA, dir: 'writeonly', src: srcA },
+    { buf: bufB, dir: 'readwrite', src: srcB }
+  ]);
+  t.equal(timings.copyBytes, numBytes * 3 / 2, 'copy bytes are totalled over the buffers');
+  t.equal(bufA[numBytes - 1], 0x1a, 'first buffer has the source data');
+  t.equal(bufB[numBytes / 2 - 1], 0x1b, 'second buffer has the source data');
+
+  try {
+    await clContext.hostAccessMany([ { buf: bufA, dir: 'readonly', src: srcA } ]);
+    t.fail('source buffer with readonly access should give error');
+  } catch (err) {
+    t.pass(`source buffer with readonly access produces ${err}`);
+  }
+});
+
+createContext('Migrate buffer between host and device', async (t, clContext) => {
+  const testBuffer = await clContext.createBuffer(numBytes, 'readwrite', 'none');
+  await testBuffer.hostAccess('writeonly', 0, Buffer.alloc(numBytes, 0x3c));
+  const timings = await testBuffer.migrate('device', clContext.queue.load);
+  t.ok(timings.totalTime >= 0, 'migration to the device resolves with timings');
+  await testBuffer.migrate('host');
+  await testBuffer.hostAccess('readonly');
+  t.equal(testBuffer[numBytes - 1], 0x3c, 'data is unchanged by migration');
+
+  try {
+    await testBuffer.migrate('sideways');
+    t.fail('unknown migration direction should give error');
+  } catch (err) {
+    t.pass(`unknown migration direction produces ${err}`);
+  }
+});
+
+createContext('Wrap an existing buffer', async (t, clContext) => {
+  const srcBuf = Buffer.alloc(numBytes);
+  for (let i=0; i<numBytes; i+=4)
+    srcBuf.writeUInt32LE(i/4, i);
+  const testBuf = await clContext.wrapBuffer(srcBuf, 'readwrite');
+  t.equal(testBuf.length, numBytes, 'wrapped buffer has the source size');
+  await testBuf.hostAccess('readonly');
+  t.deepEqual(testBuf, srcBuf, `wrapped buffer has the source contents, ${testBuf.wrapped ? 'without' : 'with'} a copy`);
+
+  await testBuf.hostAccess('none');
+  await testBuf.fill(Buffer.from([ 0x12 ]), {});
+  await testBuf.hostAccess('readonly');
+  t.equal(srcBuf[0] === 0x12, testBuf.wrapped, 'device writes are seen in the source only when wrapped');
+});
+
+createContext('Wrap an existing buffer with a bad argument', async (t, clContext) => {
+  try {
+    await clContext.wrapBuffer('not a buffer', 'readwrite');
+    t.fail('wrapping a string should fail');
+  } catch (err) {
+    t.ok(err.message.indexOf('Buffer or ArrayBuffer') >= 0, 'wrapping a string throws the expected error');
+  }
+});
+
+createContext('Create buffer larger than the device maximum allocation size', async (t, clContext) => {
+  const maxAllocSize = clContext.getPlatformInfo().devices[di].maxMemAllocSize;
+  try {
+    await clContext.createBuffer(maxAllocSize + 4096, 'readwrite');
+    t.fail('buffer larger than maximum allocation size should give error');
+  } catch (err) {
+    t.pass(`buffer larger than maximum allocation size produces ${err}`);
+  }
+});
+
+createContext('Create buffers with automatically selected type', async (t, clContext) => {
+  const first = await clContext.createBuffer(numBytes, 'readwrite', 'auto');
+  t.ok(svmTypes[pi][di].includes(first.bufType), `first buffer has a supported type ${first.bufType}`);
+  const second = await clContext.createBuffer(numBytes, 'readwrite', 'auto');
+  t.equal(second.bufType, first.bufType, 'second buffer of the same size uses the measured type');
+  await first.hostAccess('writeonly', Buffer.alloc(numBytes, 0x5a));
+  await first.hostAccess('readonly');
+  t.equal(first.readUInt32LE(numBytes - 4), 0x5a5a5a5a, 'buffer data is retained');
+  first.release();
+  second.release();
+});
+
+tape('Evict least recently used allocations to stay within the memory budget', async t => {
+  const clContext = new addon.clContext(Object.assign({ memBudgetBytes: numBytes * 3, slabMaxBytes: 0 }, properties));
+  try {
+    await clContext.initialise();
+    const buffers = [];
+    for (let i=0; i<3; ++i)
+      buffers.push(await clContext.createBuffer(numBytes, 'readwrite', 'none', { width: i + 1, height: 1 }, 'budgetTest'));
+    buffers.forEach(b => b.release());
+    t.equal(clContext.getMemStats().allocatedBytes, numBytes * 3, 'released allocations are retained');
+
+    // a new size class does not fit the budget until the oldest retained allocation is freed
+    const smallBytes = numBytes * 7 / 8;
+    const newBuffer = await clContext.createBuffer(smallBytes, 'readwrite', 'none', {}, 'budgetTest');
+    const stats = clContext.getMemStats();
+    t.equal(stats.evictions, 1, 'one allocation was evicted');
+    t.equal(stats.allocatedBytes, numBytes * 2 + smallBytes, 'allocated bytes are within the budget');
+    t.equal(stats.peakAllocatedBytes, numBytes * 3, 'peak allocated bytes are within the budget');
+    const reused = await clContext.createBuffer(numBytes, 'readwrite', 'none', { width: 3, height: 1 }, 'budgetTest');
+    t.equal(clContext.getMemStats().poolHits, stats.poolHits + 1, 'most recently released allocation was kept');
+    newBuffer.release();
+    reused.release();
+    await clContext.close(t.end);
+  } catch (err) {
+    t.fail(err);
+    t.end();
+  }
+});
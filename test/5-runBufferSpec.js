@@ -67,6 +67,7 @@ platformInfo.forEach((platform, pi) => {
   svmTypes[pi].push([]);
   platform.devices.forEach((device, di) => {
     svmTypes[pi][di].push('none');
+    svmTypes[pi][di].push('staged');
     if (device.svmCapabilities.includes('CL_DEVICE_SVM_COARSE_GRAIN_BUFFER'))
       svmTypes[pi][di].push('coarse');
     if (device.svmCapabilities.includes('CL_DEVICE_SVM_FINE_GRAIN_BUFFER'))
@@ -94,6 +95,196 @@ for (let d=0; d<bufDirs.length; ++d) {
   });
 }
 
+tape('Run OpenCL program with persistent mapping disabled', async t => {
+  const clContext = new addon.clContext(Object.assign({ unifiedMemory: false }, properties));
+  try {
+    await clContext.initialise();
+    t.notOk(clContext.context.unifiedMemory, 'unified memory mode is disabled');
+    const testProgram = await createProgram(clContext, testKernel);
+    const srcBuf = Buffer.alloc(numBytes);
+    for (let i=0; i<numBytes; i+=4)
+      srcBuf.writeUInt32LE((i/4)&0xff, i);
+
+    const bufIn = await clContext.createBuffer(numBytes, 'readonly', 'none');
+    await bufIn.hostAccess('writeonly', srcBuf);
+    const bufOut = await clContext.createBuffer(numBytes, 'writeonly', 'none');
+    await testProgram.run({ input: bufIn, output: bufOut });
+    await bufOut.hostAccess('readonly');
+    t.deepEqual(bufOut, srcBuf, 'program produced expected result');
+    await clContext.close(t.end);
+  } catch (err) {
+    t.fail(err);
+    t.end();
+  }
+});
+
+createContext('Run OpenCL program twice with the same buffers', async (t, clContext) => {
+  const testProgram = await createProgram(clContext, testKernel);
+  const bufIn = await clContext.createBuffer(numBytes, 'readonly', 'none');
+  const bufOut = await clContext.createBuffer(numBytes, 'writeonly', 'none');
+  for (let r=1; r<=2; ++r) {
+    const srcBuf = Buffer.alloc(numBytes, r);
+    await bufIn.hostAccess('writeonly', srcBuf);
+    await testProgram.run({ input: bufIn, output: bufOut });
+    await bufOut.hostAccess('readonly');
+    t.deepEqual(bufOut, srcBuf, `run ${r} produced expected result with unifiedMemory ${clContext.context.unifiedMemory}`);
+  }
+});
+
+createContext('Run OpenCL program with readback of the output', async (t, clContext) => {
+  const testProgram = await createProgram(clContext, testKernel);
+  const bufIn = await clContext.createBuffer(numBytes, 'readonly', 'none');
+  const bufOut = await clContext.createBuffer(numBytes, 'writeonly', 'none');
+  const srcBuf = Buffer.alloc(numBytes, 0x42);
+  await bufIn.hostAccess('writeonly', srcBuf);
+  await testProgram.run({ input: bufIn, output: bufOut }, { readback: [ 'output' ] });
+  t.deepEqual(bufOut, srcBuf, 'output is host readable when the run resolves');
+
+  try {
+    await testProgram.run({ input: bufIn, output: bufOut }, { readback: [ 'missing' ] });
+    t.fail('readback of an unknown parameter should give error');
+  } catch (err) {
+    t.pass(`readback of an unknown parameter produces ${err}`);
+  }
+});
+
+createContext('Run OpenCL program with bound parameters', async (t, clContext) => {
+  const testProgram = await createProgram(clContext, testKernel);
+  const bufIns = [
+    await clContext.createBuffer(numBytes, 'readonly', 'none'),
+    await clContext.createBuffer(numBytes, 'readonly', 'none') ];
+  const bufOut = await clContext.createBuffer(numBytes, 'writeonly', 'none');
+  const bound = testProgram.bind({ input: bufIns[0], output: bufOut });
+  for (let r=0; r<bufIns.length; ++r) {
+    const srcBuf = Buffer.alloc(numBytes, 0x10 + r);
+    await bufIns[r].hostAccess('writeonly', srcBuf);
+    bound.set('input', bufIns[r]);
+    await testProgram.run(bound);
+    await bufOut.hostAccess('readonly');
+    t.deepEqual(bufOut, srcBuf, `bound run ${r} produced expected result`);
+  }
+
+  t.throws(() => bound.set('missing', bufOut), /not found/, 'setting an unknown parameter gives error');
+  t.throws(() => testProgram.bind({ input: bufIns[0] }), /Incorrect number/, 'binding a missing parameter gives error');
+
+  const otherProgram = await createProgram(clContext, testKernel);
+  t.throws(() => otherProgram.run(bound), /program that bound/, 'running with another program\'s bound parameters gives error');
+  try {
+    await clContext.runMany([ { program: otherProgram, params: bound } ]);
+    t.fail('runMany with another program\'s bound parameters should give error');
+  } catch (err) {
+    t.pass(`runMany with another program's bound parameters produces ${err}`);
+  }
+});
+
+const valueKernel = `
+  __kernel void values(uchar a, short b, ulong c, float4 d, int2 e, __global float* restrict output) {
+    output[0] = a; output[1] = b; output[2] = c;
+    output[3] = d.x; output[4] = d.y; output[5] = d.z; output[6] = d.w;
+    output[7] = e.x; output[8] = e.y;
+  }
+`;
+
+createContext('Run OpenCL program with scalar and vector parameters', async (t, clContext) => {
+  const valueProgram = await clContext.createProgram(valueKernel, { name: 'values', globalWorkItems: 1 });
+  const bufOut = await clContext.createBuffer(64, 'writeonly', 'none');
+  await valueProgram.run({ a: 200, b: -3, c: 5, d: [ 1.5, 2.5, 3.5, 4.5 ], e: new Int32Array([ -7, 8 ]), output: bufOut });
+  await bufOut.hostAccess('readonly');
+  const result = Array.from(new Float32Array(bufOut.buffer, bufOut.byteOffset, 9));
+  t.deepEqual(result, [ 200, -3, 5, 1.5, 2.5, 3.5, 4.5, -7, 8 ], 'scalar and vector values set as expected');
+
+  await valueProgram.run({ a: 1, b: 2, c: 3, d: 9, e: [ 0, 0 ], output: bufOut });
+  await bufOut.hostAccess('readonly');
+  t.deepEqual(Array.from(new Float32Array(bufOut.buffer, bufOut.byteOffset, 7)).slice(3), [ 9, 9, 9, 9 ],
+    'number sets every vector component');
+
+  try {
+    await valueProgram.run({ a: 1, b: 2, c: 3, d: [ 1, 2 ], e: [ 0, 0 ], output: bufOut });
+    t.fail('vector of the wrong length should give error');
+  } catch (err) {
+    t.pass(`vector of the wrong length produces ${err}`);
+  }
+});
+
+const localKernel = `
+  __kernel void reverse(__global uint* restrict input, __local uint* tile, __global uint* restrict output) {
+    uint l = get_local_id(0);
+    uint n = get_local_size(0);
+    uint g = get_group_id(0) * n;
+    tile[l] = input[g + l];
+    barrier(CLK_LOCAL_MEM_FENCE);
+    output[g + l] = tile[n - 1 - l];
+  }
+`;
+
+createContext('Run OpenCL program with a local memory parameter', async (t, clContext) => {
+  const groupSize = 64;
+  const numItems = groupSize * 16;
+  const localProgram = await clContext.createProgram(localKernel,
+    { name: 'reverse', globalWorkItems: numItems, workItemsPerGroup: groupSize });
+  const bufIn = await clContext.createBuffer(numItems * 4, 'readonly', 'none');
+  const bufOut = await clContext.createBuffer(numItems * 4, 'writeonly', 'none');
+  const src = new Uint32Array(numItems).map((v, i) => i);
+  await bufIn.hostAccess('writeonly', Buffer.from(src.buffer));
+
+  await localProgram.run({ input: bufIn, tile: n => n * 4, output: bufOut });
+  await bufOut.hostAccess('readonly');
+  const result = new Uint32Array(bufOut.buffer, bufOut.byteOffset, numItems);
+  t.equal(result[0], groupSize - 1, 'first work-item reads the last value of its group');
+  t.equal(result[groupSize], 2 * groupSize - 1, 'second group reverses its own values');
+
+  try {
+    await localProgram.run({ input: bufIn, tile: 0x7fffffff, output: bufOut });
+    t.fail('local size larger than the device should give error');
+  } catch (err) {
+    t.pass(`local size larger than the device produces ${err}`);
+  }
+});
+
+createContext('Run many OpenCL programs in one call', async (t, clContext) => {
+  const testProgram = await createProgram(clContext, testKernel);
+  const bufs = [
+    await clContext.createBuffer(numBytes, 'readwrite', 'none'),
+    await clContext.createBuffer(numBytes, 'readwrite', 'none'),
+    await clContext.createBuffer(numBytes, 'readwrite', 'none') ];
+  const srcBuf = Buffer.alloc(numBytes, 0x5a);
+  await bufs[0].hostAccess('writeonly', srcBuf);
+  const timings = await clContext.runMany([
+    { program: testProgram, params: { input: bufs[0], output: bufs[1] } },
+    { program: testProgram, params: testProgram.bind({ input: bufs[1], output: bufs[2] }) }
+  ]);
+  t.equal(timings.length, 2, 'resolves with timings for each run');
+  t.deepEqual(await clContext.runMany([]), [], 'no runs resolves with no timings');
+  await bufs[2].hostAccess('readonly');
+  t.deepEqual(bufs[2], srcBuf, 'second kernel sees the output of the first');
+
+  try {
+    await clContext.runMany([ { program: testProgram, params: { input: bufs[0] } } ]);
+    t.fail('missing parameter should give error');
+  } catch (err) {
+    t.pass(`missing parameter produces ${err}`);
+  }
+});
+
+createContext('Run OpenCL program many times in flight', async (t, clContext) => {
+  const numRuns = 8; // more than the default libuv thread pool size
+  const bufIn = await clContext.createBuffer(numBytes, 'readonly', 'none');
+  // a program per run, as runs of one program set the arguments of the same kernel
+  const programs = [];
+  const bufOuts = [];
+  for (let r=0; r<numRuns; ++r) {
+    programs.push(await createProgram(clContext, testKernel));
+    bufOuts.push(await clContext.createBuffer(numBytes, 'writeonly', 'none'));
+  }
+  const srcBuf = Buffer.alloc(numBytes, 0x77);
+  await bufIn.hostAccess('writeonly', srcBuf);
+  const timings = await Promise.all(bufOuts.map((bufOut, r) => programs[r].run({ input: bufIn, output: bufOut })));
+  t.equal(timings.length, numRuns, 'all runs in flight resolve');
+  await clContext.hostAccessMany(bufOuts.map(bufOut => ({ buf: bufOut, dir: 'readonly' })));
+  t.ok(bufOuts.every(bufOut => 0 === srcBuf.compare(bufOut)), 'every run produced expected result');
+  await clContext.waitFinish();
+});
+
 createContext('Run OpenCL program with missing parameter', async (t, clContext) => {
   const testProgram = await createProgram(clContext, testKernel);
   const bufIn = await clContext.createBuffer(numBytes, 'readonly', 'none');
@@ -95,3 +95,141 @@ for (let d=0; d<bufDirs.length; ++d) {
     });
   });
 }
+
+createContext('Run OpenCL program with RGBA UNORM_INT16 image parameters', async (t, clContext) => {
+  const testProgram = await createProgram(clContext, testKernel);
+  const imageFormat = { width: width, height: height, channelOrder: 'RGBA', dataType: 'UNORM_INT16' };
+  const shortBytes = width * height * 4 * 2;
+  const srcBuf = Buffer.alloc(shortBytes);
+  for (let i=0; i<shortBytes; i+=2)
+    srcBuf.writeUInt16LE(i & 0xffff, i);
+
+  const bufIn = await clContext.createBuffer(shortBytes, 'readonly', 'none', imageFormat);
+  await bufIn.hostAccess('writeonly', srcBuf);
+  const bufOut = await clContext.createBuffer(shortBytes, 'writeonly', 'none', imageFormat);
+
+  await testProgram.run({ input: bufIn, output: bufOut });
+  await bufOut.hostAccess('readonly');
+  t.deepEqual(bufOut, srcBuf, 'program produced expected result');
+
+});
+
+const arrayKernel = `
+__constant sampler_t sampler =
+      CLK_NORMALIZED_COORDS_FALSE
+    | CLK_ADDRESS_CLAMP_TO_EDGE
+    | CLK_FILTER_NEAREST;
+
+__kernel void
+  test(__read_only image2d_array_t input,
+       __write_only image1d_buffer_t output) {
+
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    int f = get_global_id(2);
+    float4 in = read_imagef(input, sampler, (int4)(x,y,f,0));
+    write_imagef(output, (f * get_global_size(1) + y) * get_global_size(0) + x, in);
+  }
+`;
+
+createContext('Run OpenCL program with image2d_array_t and image1d_buffer_t parameters', async (t, clContext) => {
+  const numFrames = 3;
+  const arrayHeight = 16;
+  const testProgram = await clContext.createProgram(arrayKernel, {
+    name: 'test',
+    globalWorkItems: Uint32Array.from([ width, arrayHeight, numFrames ])
+  });
+  const arrayBytes = width * arrayHeight * numFrames * 4 * 4;
+  const imageDims = { width: width, height: arrayHeight, depth: numFrames };
+  const srcBuf = Buffer.alloc(arrayBytes);
+  for (let i=0; i<arrayBytes; i+=4)
+    srcBuf.writeFloatLE(i/arrayBytes, i);
+
+  const bufIn = await clContext.createBuffer(arrayBytes, 'readonly', 'none', imageDims);
+  await bufIn.hostAccess('writeonly', srcBuf);
+  const bufOut = await clContext.createBuffer(arrayBytes, 'writeonly', 'none', imageDims);
+
+  await testProgram.run({ input: bufIn, output: bufOut });
+  await bufOut.hostAccess('readonly');
+  t.deepEqual(bufOut, srcBuf, 'program copied all of the frames in one run');
+});
+
+createContext('Reuse a pooled image allocation for a different image format', async (t, clContext) => {
+  const testProgram = await createProgram(clContext, testKernel);
+  const halfBytes = width * height * 4 * 2;
+  const halfDims = { width: width, height: height, channelOrder: 'RGBA', dataType: 'HALF_FLOAT' };
+  const shortDims = { width: width, height: height, channelOrder: 'RGBA', dataType: 'UNORM_INT16' };
+
+  let bufIn = await clContext.createBuffer(halfBytes, 'readonly', 'none', halfDims);
+  let bufOut = await clContext.createBuffer(halfBytes, 'writeonly', 'none', halfDims);
+  await bufIn.hostAccess('writeonly', Buffer.alloc(halfBytes));
+  await testProgram.run({ input: bufIn, output: bufOut });
+  bufIn.freeAllocation();
+  bufOut.freeAllocation();
+
+  const hitsBefore = clContext.getMemStats().poolHits;
+  const srcBuf = Buffer.alloc(halfBytes);
+  for (let i=0; i<halfBytes; i+=2)
+    srcBuf.writeUInt16LE(i & 0xffff, i);
+  bufIn = await clContext.createBuffer(halfBytes, 'readonly', 'none', shortDims);
+  bufOut = await clContext.createBuffer(halfBytes, 'writeonly', 'none', shortDims);
+  t.equal(clContext.getMemStats().poolHits - hitsBefore, 2, 'allocations were reused from the pool');
+  await bufIn.hostAccess('writeonly', srcBuf);
+  await testProgram.run({ input: bufIn, output: bufOut });
+  await bufOut.hostAccess('readonly');
+  t.deepEqual(bufOut, srcBuf, 'program produced expected result with the new image format');
+});
+
+createContext('Create image buffer too small for the image format', async (t, clContext) => {
+  try {
+    await clContext.createBuffer(width * height * 2, 'readonly', 'none',
+      { width: width, height: height, channelOrder: 'RGBA', dataType: 'UNORM_INT16' });
+    t.fail('buffer too small for image format should give error');
+  } catch (err) {
+    t.pass(`buffer too small for image format produces ${err}`);
+  }
+});
+
+createContext('Create image buffer with incorrect data type', async (t, clContext) => {
+  try {
+    await clContext.createBuffer(numBytes, 'readonly', 'none', { width: width, height: height, dataType: 'FLOAT64' });
+    t.fail('incorrect image data type should give error');
+  } catch (err) {
+    t.pass(`incorrect image data type produces ${err}`);
+  }
+});
+
+createContext('Run OpenCL image program twice without implicit input copy on second run', async (t, clContext) => {
+  const testProgram = await createProgram(clContext, testKernel);
+  const srcBuf = Buffer.alloc(numBytes);
+  for (let i=0; i<numBytes; i+=4)
+    srcBuf.writeFloatLE(i/numBytes, i);
+
+  const bufIn = await clContext.createBuffer(numBytes, 'readonly', 'none', { width: width, height: height });
+  await bufIn.hostAccess('writeonly', srcBuf);
+  const bufOut = await clContext.createBuffer(numBytes, 'writeonly', 'none', { width: width, height: height });
+
+  await testProgram.run({ input: bufIn, output: bufOut });
+  const firstStats = clContext.getMemStats();
+  await testProgram.run({ input: bufIn, output: bufOut });
+  const secondStats = clContext.getMemStats();
+  t.equal(secondStats.imageCopiesToImage, firstStats.imageCopiesToImage, 'unchanged input image is not copied again');
+
+  await bufOut.hostAccess('readonly');
+  t.deepEqual(bufOut, srcBuf, 'program produced expected result');
+  const imageFromBuffer = clContext.getMemStats();
+  if (imageFromBuffer.imageCopiesToImage === 0)
+    t.equal(imageFromBuffer.imageCopiesToBuffer, 0, 'image shares buffer memory with no implicit copies');
+});
+
+createContext('Fill image buffer with a colour on the device', async (t, clContext) => {
+  const testProgram = await createProgram(clContext, testKernel);
+  const bufIn = await clContext.createBuffer(numBytes, 'readonly', 'none', { width: width, height: height });
+  await bufIn.fill([ 0.25, 0.5, 0.75, 1.0 ], {});
+  const bufOut = await clContext.createBuffer(numBytes, 'writeonly', 'none', { width: width, height: height });
+
+  await testProgram.run({ input: bufIn, output: bufOut });
+  await bufOut.hostAccess('readonly');
+  const expected = Buffer.from(Float32Array.from([ 0.25, 0.5, 0.75, 1.0 ]).buffer);
+  t.ok(bufOut.slice(0, 16).equals(expected) && bufOut.slice(numBytes - 16).equals(expected), 'image filled with colour');
+});